@@ -0,0 +1,603 @@
+// Multithreaded load generator and latency benchmark for /dev/hangman
+//
+// Each thread runs a weighted mix of operations against the driver, either on
+// its own file descriptor or on one shared by every thread, and records the
+// latency of each call in a log-linear histogram. Results are printed as a
+// table or, with -j, as JSON so runs can be compared between driver versions.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "module/hangman_uapi.h"
+
+#define DEFAULT_PATH "/dev/hangman"
+#define BUF_SIZE 256
+#define SNAPSHOT_SIZE 16384
+#define MAX_SPARE_GAMES 16
+
+// histogram buckets: values below 2^SUB_BITS are exact, above that each power
+// of two is split into 2^SUB_BITS buckets, so every bucket is within ~6%
+#define SUB_BITS 4
+#define SUB_COUNT (1 << SUB_BITS)
+#define NUM_BUCKETS ((64 - SUB_BITS + 1) * SUB_COUNT)
+
+enum op {
+    OP_READ,
+    OP_WRITE,
+    OP_LSEEK,
+    OP_READ_BANK,
+    OP_READ_SECRET,
+    OP_WRITE_BANK,
+    OP_WRITE_SECRET,
+    OP_RESTART,
+    OP_GET_STATE,
+    OP_BATCH_RESULT,
+    OP_GAME_GUESS,
+    OP_GAME_STATE,
+    OP_SET_BATCH,
+    OP_GAME_CREATE,
+    OP_GAME_DESTROY,
+    OP_GAME_RESTART,
+    OP_BANK_BEGIN,
+    OP_BANK_APPEND,
+    OP_BANK_COMMIT,
+    OP_BANK_ABORT,
+    OP_SET_FILTER,
+    OP_HINT,
+    OP_BANK_READ,
+    OP_SNAPSHOT_SAVE,
+    NUM_OPS,
+};
+
+static const char* opNames[NUM_OPS] = {
+    [OP_READ] = "read",
+    [OP_WRITE] = "write",
+    [OP_LSEEK] = "lseek",
+    [OP_READ_BANK] = "read_bank",
+    [OP_READ_SECRET] = "read_secret",
+    [OP_WRITE_BANK] = "write_bank",
+    [OP_WRITE_SECRET] = "write_secret",
+    [OP_RESTART] = "restart",
+    [OP_GET_STATE] = "get_state",
+    [OP_BATCH_RESULT] = "batch_result",
+    [OP_GAME_GUESS] = "game_guess",
+    [OP_GAME_STATE] = "game_state",
+    [OP_SET_BATCH] = "set_batch",
+    [OP_GAME_CREATE] = "game_create",
+    [OP_GAME_DESTROY] = "game_destroy",
+    [OP_GAME_RESTART] = "game_restart",
+    [OP_BANK_BEGIN] = "bank_begin",
+    [OP_BANK_APPEND] = "bank_append",
+    [OP_BANK_COMMIT] = "bank_commit",
+    [OP_BANK_ABORT] = "bank_abort",
+    [OP_SET_FILTER] = "set_filter",
+    [OP_HINT] = "hint",
+    [OP_BANK_READ] = "bank_read",
+    [OP_SNAPSHOT_SAVE] = "snapshot_save",
+};
+
+struct op_stats {
+    uint64_t count;
+    uint64_t errors;
+    uint64_t buckets[NUM_BUCKETS];
+};
+
+struct config {
+    const char* path;
+    int threads;
+    double seconds;
+    bool sharedFd;
+    bool sweep;
+    bool json;
+    unsigned weights[NUM_OPS];
+    unsigned totalWeight;
+};
+
+struct worker {
+    pthread_t thread;
+    const struct config* cfg;
+    int fd;
+    uint32_t handle;
+    bool gameOver;          // the handle game is won or lost
+    uint32_t spare[MAX_SPARE_GAMES];    // games made by game_create
+    int spareCount;
+    uint64_t rng;
+    volatile bool* stop;
+    struct op_stats stats[NUM_OPS];
+};
+
+static unsigned bucket_index(uint64_t v)
+{
+    if(v < SUB_COUNT)
+        return v;
+
+    unsigned exp = 63 - __builtin_clzll(v);
+    unsigned sub = (v >> (exp - SUB_BITS)) & (SUB_COUNT - 1);
+    return (exp - SUB_BITS + 1) * SUB_COUNT + sub;
+}
+
+// upper bound of the values counted in bucket i
+static uint64_t bucket_value(unsigned i)
+{
+    if(i < SUB_COUNT)
+        return i;
+
+    unsigned exp = i / SUB_COUNT + SUB_BITS - 1;
+    uint64_t sub = i % SUB_COUNT;
+    return ((SUB_COUNT + sub + 1) << (exp - SUB_BITS)) - 1;
+}
+
+static uint64_t percentile(const struct op_stats* s, double p)
+{
+    if(s->count == 0)
+        return 0;
+
+    uint64_t target = (uint64_t)(p * s->count);
+    if(target >= s->count)
+        target = s->count - 1;
+
+    uint64_t seen = 0;
+    for(unsigned i = 0; i < NUM_BUCKETS; i++) {
+        seen += s->buckets[i];
+        if(seen > target)
+            return bucket_value(i);
+    }
+
+    return bucket_value(NUM_BUCKETS - 1);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t next_rand(uint64_t* state)
+{
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ull;
+}
+
+static enum op pick_op(struct worker* w)
+{
+    unsigned r = next_rand(&w->rng) % w->cfg->totalWeight;
+    for(int i = 0; i < NUM_OPS; i++) {
+        if(r < w->cfg->weights[i])
+            return i;
+
+        r -= w->cfg->weights[i];
+    }
+
+    return OP_READ;
+}
+
+static const char benchBank[] = "EXAMPLE,BENCHMARK,HANGMAN";
+
+// set up what op needs to succeed, off the clock, so each op times exactly
+// one call to the driver
+static void prepare_op(struct worker* w, enum op op)
+{
+    struct hangman_bank_chunk chunk = { .data = (uintptr_t)benchBank, .len = sizeof(benchBank) - 1 };
+
+    switch(op) {
+    case OP_GAME_CREATE:
+        if(w->spareCount == MAX_SPARE_GAMES)
+            ioctl(w->fd, HANGMAN_IOC_GAME_DESTROY, &w->spare[--w->spareCount]);
+        break;
+    case OP_GAME_DESTROY:
+        if(w->spareCount == 0 && ioctl(w->fd, HANGMAN_IOC_GAME_CREATE, &w->spare[0]) == 0)
+            w->spareCount = 1;
+        break;
+    case OP_BANK_APPEND:
+    case OP_BANK_ABORT:
+        ioctl(w->fd, HANGMAN_IOC_BANK_BEGIN);
+        break;
+    case OP_BANK_COMMIT:
+        if(ioctl(w->fd, HANGMAN_IOC_BANK_BEGIN) == 0)
+            ioctl(w->fd, HANGMAN_IOC_BANK_APPEND, &chunk);
+        break;
+    default:
+        break;
+    }
+}
+
+// returns false if the call failed
+static bool run_op(struct worker* w, enum op op)
+{
+    char buf[BUF_SIZE] = {0};
+    char guess[2] = {0};
+    char secret[MAX_SECRET_SIZE] = "BENCHMARK";
+    char bank[MAX_BANK_SIZE] = "EXAMPLE,BENCHMARK,HANGMAN";
+    struct hangman_state state;
+    struct hangman_batch_result result;
+    struct hangman_game_guess gameGuess = { .handle = w->handle };
+    struct hangman_game_state gameState = { .handle = w->handle };
+    struct hangman_bank_chunk chunk = { .data = (uintptr_t)benchBank, .len = sizeof(benchBank) - 1 };
+    struct hangman_word_filter filter = {0};
+    struct hangman_hint hint;
+    struct hangman_bank_read bankRead = { .data = (uintptr_t)buf, .len = BUF_SIZE };
+    char snapshot[SNAPSHOT_SIZE];
+    struct hangman_snapshot_buf snapshotBuf = { .data = (uintptr_t)snapshot, .len = sizeof(snapshot) };
+    int batch;
+
+    switch(op) {
+    case OP_READ:
+        return pread(w->fd, buf, BUF_SIZE, 0) >= 0;
+    case OP_WRITE:
+        guess[0] = 'A' + next_rand(&w->rng) % 26;
+        return write(w->fd, guess, 2) == 2;
+    case OP_LSEEK:
+        return lseek(w->fd, 0, SEEK_SET) >= 0;
+    case OP_READ_BANK:
+        return ioctl(w->fd, HANGMAN_IOC_READ_BANK, buf) == 0;
+    case OP_READ_SECRET:
+        return ioctl(w->fd, HANGMAN_IOC_READ_SECRET, buf) == 0;
+    case OP_WRITE_BANK:
+        return ioctl(w->fd, HANGMAN_IOC_WRITE_BANK, bank) == 0;
+    case OP_WRITE_SECRET:
+        return ioctl(w->fd, HANGMAN_IOC_WRITE_SECRET, secret) == 0;
+    case OP_RESTART:
+        return ioctl(w->fd, HANGMAN_IOC_RESTART) == 0;
+    case OP_GET_STATE:
+        return ioctl(w->fd, HANGMAN_IOC_GET_STATE, &state) == 0;
+    case OP_BATCH_RESULT:
+        return ioctl(w->fd, HANGMAN_IOC_BATCH_RESULT, &result) == 0;
+    case OP_GAME_GUESS:
+        gameGuess.letter = 'A' + next_rand(&w->rng) % 26;
+        if(ioctl(w->fd, HANGMAN_IOC_GAME_GUESS, &gameGuess) != 0)
+            return false;
+
+        // later guesses would be skipped, worker_main() starts another game
+        w->gameOver = gameGuess.status != HANGMAN_STATUS_PLAYING;
+        return true;
+    case OP_GAME_STATE:
+        return ioctl(w->fd, HANGMAN_IOC_GAME_STATE, &gameState) == 0;
+    case OP_SET_BATCH:
+        // a 2-byte guess is also a valid batch write, so OP_WRITE works either way
+        batch = next_rand(&w->rng) % 2;
+        return ioctl(w->fd, HANGMAN_IOC_SET_BATCH, &batch) == 0;
+    case OP_GAME_CREATE:
+        if(ioctl(w->fd, HANGMAN_IOC_GAME_CREATE, &w->spare[w->spareCount]) != 0)
+            return false;
+
+        w->spareCount++;
+        return true;
+    case OP_GAME_DESTROY:
+        if(w->spareCount == 0)
+            return false;
+
+        return ioctl(w->fd, HANGMAN_IOC_GAME_DESTROY, &w->spare[--w->spareCount]) == 0;
+    case OP_GAME_RESTART:
+        return ioctl(w->fd, HANGMAN_IOC_GAME_RESTART, &w->handle) == 0;
+    case OP_BANK_BEGIN:
+        return ioctl(w->fd, HANGMAN_IOC_BANK_BEGIN) == 0;
+    case OP_BANK_APPEND:
+        return ioctl(w->fd, HANGMAN_IOC_BANK_APPEND, &chunk) == 0;
+    case OP_BANK_COMMIT:
+        return ioctl(w->fd, HANGMAN_IOC_BANK_COMMIT) == 0;
+    case OP_BANK_ABORT:
+        return ioctl(w->fd, HANGMAN_IOC_BANK_ABORT) == 0;
+    case OP_SET_FILTER:
+        return ioctl(w->fd, HANGMAN_IOC_SET_FILTER, &filter) == 0;
+    case OP_HINT:
+        return ioctl(w->fd, HANGMAN_IOC_HINT, &hint) == 0;
+    case OP_BANK_READ:
+        return ioctl(w->fd, HANGMAN_IOC_BANK_READ, &bankRead) == 0;
+    case OP_SNAPSHOT_SAVE:
+        return ioctl(w->fd, HANGMAN_IOC_SNAPSHOT_SAVE, &snapshotBuf) == 0;
+    default:
+        return false;
+    }
+}
+
+static void* worker_main(void* arg)
+{
+    struct worker* w = arg;
+
+    while(!*w->stop) {
+        enum op op = pick_op(w);
+        prepare_op(w, op);
+
+        uint64_t start = now_ns();
+        bool ok = run_op(w, op);
+        uint64_t elapsed = now_ns() - start;
+
+        struct op_stats* s = &w->stats[op];
+        s->count++;
+        s->buckets[bucket_index(elapsed)]++;
+
+        if(!ok) {
+            s->errors++;
+
+            // a finished game rejects guesses, start a new round off the clock
+            if(op == OP_WRITE) {
+                char secret[MAX_SECRET_SIZE] = "BENCHMARK";
+                ioctl(w->fd, HANGMAN_IOC_WRITE_SECRET, secret);
+            }
+        }
+
+        if(w->gameOver) {
+            ioctl(w->fd, HANGMAN_IOC_GAME_RESTART, &w->handle);
+            w->gameOver = false;
+        }
+    }
+
+    return NULL;
+}
+
+static void print_results(const struct config* cfg, int threads, double seconds,
+                          const struct op_stats* totals, bool first)
+{
+    uint64_t allOps = 0;
+    for(int i = 0; i < NUM_OPS; i++)
+        allOps += totals[i].count;
+
+    if(cfg->json) {
+        printf("%s{\"threads\": %d, \"shared_fd\": %s, \"seconds\": %.3f, "
+               "\"total_ops\": %llu, \"ops_per_sec\": %.1f, \"ops\": {",
+               first ? "" : ",\n", threads, cfg->sharedFd ? "true" : "false", seconds,
+               (unsigned long long)allOps, allOps / seconds);
+
+        bool firstOp = true;
+        for(int i = 0; i < NUM_OPS; i++) {
+            const struct op_stats* s = &totals[i];
+            if(cfg->weights[i] == 0)
+                continue;
+
+            printf("%s\"%s\": {\"count\": %llu, \"errors\": %llu, \"ops_per_sec\": %.1f, "
+                   "\"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu}",
+                   firstOp ? "" : ", ", opNames[i], (unsigned long long)s->count,
+                   (unsigned long long)s->errors, s->count / seconds,
+                   (unsigned long long)percentile(s, 0.50),
+                   (unsigned long long)percentile(s, 0.99),
+                   (unsigned long long)percentile(s, 0.999));
+            firstOp = false;
+        }
+
+        printf("}}");
+        return;
+    }
+
+    printf("threads: %d  fd: %s  ops: %llu  ops/sec: %.1f\n", threads,
+           cfg->sharedFd ? "shared" : "separate", (unsigned long long)allOps, allOps / seconds);
+    printf("%-14s %12s %10s %14s %10s %10s %10s\n",
+           "op", "count", "errors", "ops/sec", "p50 ns", "p99 ns", "p999 ns");
+
+    for(int i = 0; i < NUM_OPS; i++) {
+        const struct op_stats* s = &totals[i];
+        if(cfg->weights[i] == 0)
+            continue;
+
+        printf("%-14s %12llu %10llu %14.1f %10llu %10llu %10llu\n", opNames[i],
+               (unsigned long long)s->count, (unsigned long long)s->errors, s->count / seconds,
+               (unsigned long long)percentile(s, 0.50),
+               (unsigned long long)percentile(s, 0.99),
+               (unsigned long long)percentile(s, 0.999));
+    }
+}
+
+// open a file descriptor with a handle game ready for the game_* ops
+static int open_device(const struct config* cfg, uint32_t* handle)
+{
+    int fd = open(cfg->path, O_RDWR);
+    if(fd < 0)
+        return -1;
+
+    *handle = 0;
+    if(cfg->weights[OP_GAME_GUESS] || cfg->weights[OP_GAME_STATE] || cfg->weights[OP_GAME_RESTART]) {
+        if(ioctl(fd, HANGMAN_IOC_GAME_CREATE, handle) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+static bool run_benchmark(const struct config* cfg, int threads, bool first)
+{
+    struct worker* workers = calloc(threads, sizeof(*workers));
+    struct op_stats* totals = calloc(NUM_OPS, sizeof(*totals));
+    volatile bool stop = false;
+    bool ok = true;
+    int sharedFd = -1;
+    uint32_t sharedHandle = 0;
+    int started = 0;
+
+    if(!workers || !totals) {
+        ok = false;
+        goto out;
+    }
+
+    if(cfg->sharedFd) {
+        sharedFd = open_device(cfg, &sharedHandle);
+        if(sharedFd < 0) {
+            perror(cfg->path);
+            ok = false;
+            goto out;
+        }
+    }
+
+    for(int i = 0; i < threads; i++) {
+        struct worker* w = &workers[i];
+        w->cfg = cfg;
+        w->stop = &stop;
+        w->rng = 0x9e3779b97f4a7c15ull * (i + 1);
+        w->fd = sharedFd;
+        w->handle = sharedHandle;
+
+        if(!cfg->sharedFd) {
+            w->fd = open_device(cfg, &w->handle);
+            if(w->fd < 0) {
+                perror(cfg->path);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    uint64_t start = now_ns();
+    for(; ok && started < threads; started++) {
+        if(pthread_create(&workers[started].thread, NULL, worker_main, &workers[started]) != 0) {
+            perror("pthread_create");
+            ok = false;
+            break;
+        }
+    }
+
+    if(ok) {
+        struct timespec ts = { .tv_sec = (time_t)cfg->seconds,
+                               .tv_nsec = (long)((cfg->seconds - (time_t)cfg->seconds) * 1e9) };
+        nanosleep(&ts, NULL);
+    }
+
+    stop = true;
+    for(int i = 0; i < started; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    double seconds = (now_ns() - start) / 1e9;
+
+    for(int i = 0; i < threads; i++) {
+        for(int op = 0; op < NUM_OPS; op++) {
+            totals[op].count += workers[i].stats[op].count;
+            totals[op].errors += workers[i].stats[op].errors;
+            for(int b = 0; b < NUM_BUCKETS; b++)
+                totals[op].buckets[b] += workers[i].stats[op].buckets[b];
+        }
+
+        if(!cfg->sharedFd && workers[i].fd >= 0)
+            close(workers[i].fd);
+    }
+
+    if(ok)
+        print_results(cfg, threads, seconds, totals, first);
+
+out:
+    if(sharedFd >= 0)
+        close(sharedFd);
+
+    free(workers);
+    free(totals);
+    return ok;
+}
+
+// parse "read=50,write=30,..." into cfg->weights
+static bool parse_mix(struct config* cfg, char* mix)
+{
+    memset(cfg->weights, 0, sizeof(cfg->weights));
+
+    for(char* item = strtok(mix, ","); item; item = strtok(NULL, ",")) {
+        char* eq = strchr(item, '=');
+        if(eq)
+            *eq = '\0';
+
+        int op = 0;
+        while(op < NUM_OPS && strcmp(opNames[op], item) != 0)
+            op++;
+
+        if(op == NUM_OPS) {
+            fprintf(stderr, "unknown op '%s'\n", item);
+            return false;
+        }
+
+        cfg->weights[op] = eq ? strtoul(eq + 1, NULL, 10) : 1;
+    }
+
+    return true;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [-t threads] [-d seconds] [-m mix] [-p path] [-s] [-S] [-j]\n"
+            "  -t  number of threads (default 1)\n"
+            "  -d  seconds to run each benchmark (default 5)\n"
+            "  -m  weighted op mix, e.g. read=50,write=30,lseek=10,get_state=10\n"
+            "      ops:", prog);
+
+    for(int i = 0; i < NUM_OPS; i++)
+        fprintf(stderr, " %s", opNames[i]);
+
+    fprintf(stderr,
+            "\n"
+            "  -p  device path (default " DEFAULT_PATH ")\n"
+            "  -s  all threads share one file descriptor\n"
+            "  -S  sweep the thread count from 1 to -t\n"
+            "  -j  print results as JSON\n");
+}
+
+int main(int argc, char** argv)
+{
+    char defaultMix[] = "read=40,write=30,lseek=10,get_state=10,read_bank=5,read_secret=5";
+    struct config cfg = { .path = DEFAULT_PATH, .threads = 1, .seconds = 5 };
+    char* mix = defaultMix;
+    int opt;
+
+    while((opt = getopt(argc, argv, "t:d:m:p:sSjh")) != -1) {
+        switch(opt) {
+        case 't':
+            cfg.threads = atoi(optarg);
+            break;
+        case 'd':
+            cfg.seconds = atof(optarg);
+            break;
+        case 'm':
+            mix = optarg;
+            break;
+        case 'p':
+            cfg.path = optarg;
+            break;
+        case 's':
+            cfg.sharedFd = true;
+            break;
+        case 'S':
+            cfg.sweep = true;
+            break;
+        case 'j':
+            cfg.json = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(cfg.threads < 1 || cfg.seconds <= 0 || !parse_mix(&cfg, mix)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for(int i = 0; i < NUM_OPS; i++)
+        cfg.totalWeight += cfg.weights[i];
+
+    if(cfg.totalWeight == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(cfg.json)
+        printf("[");
+
+    bool ok = true;
+    for(int threads = cfg.sweep ? 1 : cfg.threads; ok && threads <= cfg.threads; threads++) {
+        ok = run_benchmark(&cfg, threads, threads == (cfg.sweep ? 1 : cfg.threads));
+        if(!cfg.json && threads != cfg.threads)
+            printf("\n");
+    }
+
+    if(cfg.json)
+        printf("]\n");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// Microbenchmark of the hangman game engine, built from module/hangman_core.c
+// against the userspace shim so it runs without loading the module
+//
+// Plays games back to back on one game object: each round draws a word from
+// the bank and guesses letters in English frequency order until the game is
+// won or lost, as a client would through write(). Optionally renders the
+// output after every guess like a client reading the game between writes.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "module/hangman_core.h"
+
+#define CHUNK_SIZE 4096
+
+static const char defaultWords[] =
+    "EXAMPLE,KERNEL,MODULE,HANGMAN,DEVICE,DRIVER,MUTEX,SCHEDULER,"
+    "INTERRUPT,SEMAPHORE,PROCESS,THREAD,MEMORY,PAGE,FILESYSTEM,SOCKET";
+
+static const char letterOrder[] = "ETAOINSHRDLCUMWFGYPBVKJXQZ";
+
+static u64 stats[NR_STATS];
+
+void count_stat(enum hangman_stat stat)
+{
+    stats[stat]++;
+}
+
+void game_notify(struct hangman_game* game)
+{
+    (void)game;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// stream a word list through the same parser the module uses
+static struct word_bank* load_bank(const char* path)
+{
+    struct bank_load load;
+    char buf[CHUNK_SIZE];
+    int err = bank_load_init(&load);
+    if(err)
+        return NULL;
+
+    if(!path) {
+        err = bank_load_feed(&load, defaultWords, strlen(defaultWords));
+    } else {
+        FILE* f = fopen(path, "r");
+        if(!f) {
+            perror(path);
+            bank_load_abort(&load);
+            return NULL;
+        }
+
+        size_t n;
+        while(!err && (n = fread(buf, 1, sizeof(buf), f)) > 0)
+            err = bank_load_feed(&load, buf, n);
+
+        fclose(f);
+    }
+
+    if(err) {
+        bank_load_abort(&load);
+        return NULL;
+    }
+
+    struct word_bank* bank = bank_load_finish(&load);
+    return IS_ERR(bank) ? NULL : bank;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n games] [-f wordfile] [-b] [-r]\n"
+            "  -n  number of games to play (default 1000000)\n"
+            "  -f  comma or newline separated word list (default: built in list)\n"
+            "  -b  send all guesses of a round at once, like a batch write\n"
+            "  -r  render the output after every guess, like a client reading\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    long games = 1000000;
+    const char* path = NULL;
+    bool batch = false;
+    bool render = false;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:f:brh")) != -1) {
+        switch(opt) {
+        case 'n':
+            games = atol(optarg);
+            break;
+        case 'f':
+            path = optarg;
+            break;
+        case 'b':
+            batch = true;
+            break;
+        case 'r':
+            render = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(games <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct word_bank* bank = load_bank(path);
+    if(!bank) {
+        fprintf(stderr, "could not load the word bank\n");
+        return 1;
+    }
+
+    struct hangman_game* game = kzalloc(sizeof(*game), GFP_KERNEL);
+    if(!game) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    mutex_init(&game->lock);
+    spin_lock_init(&game->next_lock);
+    size_t outputBytes = 0;
+
+    double start = now_sec();
+    for(long i = 0; i < games; i++) {
+        mutex_lock(&game->lock);
+        new_round(game, bank);
+
+        if(batch) {
+            play_guesses(game, letterOrder, sizeof(letterOrder) - 1);
+        } else {
+            for(int l = 0; game->status == HANGMAN_STATUS_PLAYING; l++) {
+                apply_guess(game, letterOrder[l]);
+                if(render) {
+                    struct hangman_state state;
+                    char output[OUTPUT_SIZE];
+
+                    fill_state(game, &state);
+                    outputBytes += render_state(&state, output);
+                }
+            }
+        }
+
+        mutex_unlock(&game->lock);
+        prepare_next_round(game, bank);
+    }
+    double elapsed = now_sec() - start;
+
+    printf("words: %u\n", bank->word_count);
+    printf("games: %llu (won %llu, lost %llu)\n", (unsigned long long)stats[STAT_GAMES_STARTED],
+           (unsigned long long)stats[STAT_GAMES_WON], (unsigned long long)stats[STAT_GAMES_LOST]);
+    printf("guesses: %llu\n", (unsigned long long)stats[STAT_GUESSES]);
+    printf("seconds: %.3f\n", elapsed);
+    printf("games/sec: %.0f\n", games / elapsed);
+    printf("guesses/sec: %.0f\n", stats[STAT_GUESSES] / elapsed);
+    if(render)
+        printf("output bytes rendered: %zu\n", outputBytes);
+
+    mutex_destroy(&game->lock);
+    kfree(game);
+    free_word_bank(bank);
+    return 0;
+}
@@ -0,0 +1,1008 @@
+#include "hangman_core.h"
+
+// source of word_bank.gen
+static atomic64_t bank_gens = ATOMIC64_INIT(0);
+
+u32 bank_max_words = 1 << 20;
+u32 bank_max_bytes = 16 << 20;
+
+void free_word_bank(struct word_bank* bank)
+{
+	kvfree(bank->offsets);
+	kvfree(bank->lengths);
+	kvfree(bank->arena);
+	kvfree(bank->by_key);
+	kvfree(bank->key_start);
+	kvfree(bank->key_letters);
+	kfree(bank);
+}
+
+bool bank_builder_init(struct word_bank_builder* b)
+{
+	b->word_cap = 0;
+	b->arena_cap = 0;
+	b->bank = kzalloc(sizeof(*b->bank), GFP_KERNEL_ACCOUNT);
+	return b->bank != NULL;
+}
+
+// resize a kvmalloc'd array, keeping the first used bytes
+static void* bank_grow(void* old, size_t used, size_t new_size)
+{
+	void* new = kvmalloc(new_size, GFP_KERNEL_ACCOUNT);
+	if(!new)
+		return NULL;
+
+	if(old)
+		memcpy(new, old, used);
+
+	kvfree(old);
+	return new;
+}
+
+// guesses are the letters 'A' to 'Z', only words made of nothing else can be
+// won, whatever their case
+static bool word_playable(const char* word, size_t len)
+{
+	for(size_t i = 0; i < len; i++) {
+		char c = toupper(word[i]);
+		if(c < 'A' || c > 'Z')
+			return false;
+	}
+
+	return len != 0;
+}
+
+// words are stored in uppercase, empty words and words with anything but
+// letters are skipped. Words longer than MAX_WORD_LEN are truncated, a bank
+// that would grow past bank_max_words or bank_max_bytes fails with -E2BIG
+int bank_builder_add(struct word_bank_builder* b, const char* word, size_t len)
+{
+	struct word_bank* bank = b->bank;
+
+	len = min_t(size_t, len, MAX_WORD_LEN);
+	if(!word_playable(word, len))
+		return 0;
+
+	if(bank->word_count >= READ_ONCE(bank_max_words))
+		return -E2BIG;
+
+	if(bank->word_count == b->word_cap) {
+		u32 cap = b->word_cap ? b->word_cap * 2 : 64;
+		if(cap <= b->word_cap)
+			return -E2BIG;
+
+		u32* offsets = bank_grow(bank->offsets, bank->word_count * sizeof(u32), cap * sizeof(u32));
+		if(!offsets)
+			return -ENOMEM;
+		bank->offsets = offsets;
+
+		u8* lengths = bank_grow(bank->lengths, bank->word_count, cap);
+		if(!lengths)
+			return -ENOMEM;
+		bank->lengths = lengths;
+
+		b->word_cap = cap;
+	}
+
+	u32 needed;
+	if(check_add_overflow(bank->arena_len, (u32)len + 1, &needed) ||
+	   needed > READ_ONCE(bank_max_bytes))
+		return -E2BIG;
+
+	if(needed > b->arena_cap) {
+		u32 cap = max_t(u32, b->arena_cap ? b->arena_cap * 2 : 512, needed);
+		if(cap < b->arena_cap)
+			cap = U32_MAX;
+
+		char* arena = bank_grow(bank->arena, bank->arena_len, cap);
+		if(!arena)
+			return -ENOMEM;
+
+		bank->arena = arena;
+		b->arena_cap = cap;
+	}
+
+	bank->offsets[bank->word_count] = bank->arena_len;
+	bank->lengths[bank->word_count] = len;
+	for(size_t i = 0; i < len; i++)
+		bank->arena[bank->arena_len + i] = toupper(word[i]);
+	bank->arena[bank->arena_len + len] = ',';
+
+	bank->arena_len = needed;
+	bank->word_count++;
+	return 0;
+}
+
+// bit (c - 'A') is set for every letter c in word
+static u32 word_letters(const char* word, size_t len)
+{
+	u32 letters = 0;
+
+	// bank words are uppercase letters only, see bank_builder_add()
+	for(size_t i = 0; i < len; i++)
+		letters |= BIT(word[i] - 'A');
+
+	return letters;
+}
+
+static inline u32 word_key(u8 len, u8 difficulty)
+{
+	return len * (MAX_DIFFICULTY + 1) + difficulty;
+}
+
+// bucket the words by length and difficulty with a counting sort
+static int bank_build_index(struct word_bank* bank)
+{
+	int err = -ENOMEM;
+	u32 n = max_t(u32, bank->word_count, 1);
+	u32* keys = kvmalloc_array(n, sizeof(u32), GFP_KERNEL_ACCOUNT);
+	u32* letters = kvmalloc_array(n, sizeof(u32), GFP_KERNEL_ACCOUNT);
+	u32* fill = kvmalloc_array(NUM_WORD_KEYS, sizeof(u32), GFP_KERNEL_ACCOUNT);
+	bank->by_key = kvmalloc_array(n, sizeof(u32), GFP_KERNEL_ACCOUNT);
+	bank->key_start = kvcalloc(NUM_WORD_KEYS + 1, sizeof(u32), GFP_KERNEL_ACCOUNT);
+	bank->key_letters = kvmalloc_array(n, sizeof(u32), GFP_KERNEL_ACCOUNT);
+
+	if(!keys || !letters || !fill || !bank->by_key || !bank->key_start || !bank->key_letters)
+		goto out;
+
+	// a word's difficulty is the number of distinct letters in it
+	for(u32 i = 0; i < bank->word_count; i++) {
+		u8 len = bank->lengths[i];
+		letters[i] = word_letters(bank_word(bank, i), len);
+		keys[i] = word_key(len, hweight32(letters[i]));
+		bank->key_start[keys[i] + 1]++;
+	}
+
+	for(u32 k = 0; k < NUM_WORD_KEYS; k++)
+		bank->key_start[k + 1] += bank->key_start[k];
+
+	memcpy(fill, bank->key_start, NUM_WORD_KEYS * sizeof(u32));
+	for(u32 i = 0; i < bank->word_count; i++) {
+		u32 j = fill[keys[i]]++;
+		bank->by_key[j] = i;
+		bank->key_letters[j] = letters[i];
+	}
+
+	err = 0;
+out:
+	kvfree(fill);
+	kvfree(letters);
+	kvfree(keys);
+	return err;
+}
+
+// returns the finished bank, or NULL if it could not be indexed
+struct word_bank* bank_builder_finish(struct word_bank_builder* b)
+{
+	struct word_bank* bank = b->bank;
+	b->bank = NULL;
+
+	if(bank_build_index(bank)) {
+		free_word_bank(bank);
+		return NULL;
+	}
+
+	bank->gen = atomic64_inc_return(&bank_gens);
+	return bank;
+}
+
+void bank_builder_abort(struct word_bank_builder* b)
+{
+	if(b->bank)
+		free_word_bank(b->bank);
+
+	b->bank = NULL;
+}
+
+struct word_bank* alloc_default_bank(void)
+{
+	struct word_bank_builder b;
+	if(!bank_builder_init(&b))
+		return NULL;
+
+	if(bank_builder_add(&b, "EXAMPLE", strlen("EXAMPLE"))) {
+		bank_builder_abort(&b);
+		return NULL;
+	}
+
+	struct word_bank* bank = bank_builder_finish(&b);
+	if(bank)
+		bank->builtin = true;
+
+	return bank;
+}
+
+static inline bool filter_is_set(const struct hangman_word_filter* f)
+{
+	return f->min_len || f->max_len || f->min_difficulty || f->max_difficulty;
+}
+
+// Lengths and difficulties a filter lets through, with its 0 limits filled in
+struct word_range {
+	u8 min_len;
+	u8 max_len;
+	u8 min_diff;
+	u8 max_diff;
+};
+
+// returns false if the filter can't match any word
+static bool filter_range(const struct hangman_word_filter* f, struct word_range* r)
+{
+	r->min_len = f->min_len;
+	r->max_len = f->max_len ? min_t(u8, f->max_len, MAX_WORD_LEN) : MAX_WORD_LEN;
+	r->min_diff = f->min_difficulty;
+	r->max_diff = f->max_difficulty ? min_t(u8, f->max_difficulty, MAX_DIFFICULTY) : MAX_DIFFICULTY;
+
+	return r->min_len <= r->max_len && r->min_diff <= r->max_diff;
+}
+
+// each length contributes one contiguous span of by_key
+static inline u32 span_start(const struct word_bank* bank, const struct word_range* r, u8 len)
+{
+	return bank->key_start[word_key(len, r->min_diff)];
+}
+
+static inline u32 span_len(const struct word_bank* bank, const struct word_range* r, u8 len)
+{
+	return bank->key_start[word_key(len, r->max_diff) + 1] - span_start(bank, r, len);
+}
+
+// number of words in bank that pass filter
+// should only be used under rcu_read_lock()
+u32 bank_count(const struct word_bank* bank, const struct hangman_word_filter* f)
+{
+	struct word_range r;
+
+	if(!filter_is_set(f))
+		return bank->word_count;
+
+	if(!filter_range(f, &r))
+		return 0;
+
+	u32 total = 0;
+	for(u8 len = r.min_len; len <= r.max_len; len++)
+		total += span_len(bank, &r, len);
+
+	return total;
+}
+
+// index of the nth word of bank that passes filter, n must be below
+// bank_count()
+static u32 bank_nth(const struct word_bank* bank, const struct hangman_word_filter* f, u32 n)
+{
+	struct word_range r;
+
+	if(!filter_is_set(f) || !filter_range(f, &r))
+		return n;
+
+	for(u8 len = r.min_len; len <= r.max_len; len++) {
+		u32 span = span_len(bank, &r, len);
+
+		if(n < span)
+			return bank->by_key[span_start(bank, &r, len) + n];
+
+		n -= span;
+	}
+
+	return 0;
+}
+
+// new random permutation, starting over with every word in the bag
+static void bag_shuffle(struct shuffle_bag* bag)
+{
+	for(int i = 0; i < BAG_ROUNDS; i++)
+		bag->keys[i] = get_random_u32();
+
+	bag->drawn = 0;
+}
+
+static void bag_fill(struct shuffle_bag* bag, const struct word_bank* bank,
+                     const struct hangman_word_filter* f)
+{
+	bag->bank_gen = bank->gen;
+	bag->filter = *f;
+	bag->total = bank_count(bank, f);
+
+	bag->half_bits = 1;
+	while((1ULL << (2 * bag->half_bits)) < bag->total)
+		bag->half_bits++;
+
+	bag_shuffle(bag);
+}
+
+// the Feistel round function, murmur3's finalizer
+static inline u32 bag_mix(u32 x, u32 key)
+{
+	x ^= key;
+	x ^= x >> 16;
+	x *= 0x85ebca6b;
+	x ^= x >> 13;
+	x *= 0xc2b2ae35;
+	x ^= x >> 16;
+	return x;
+}
+
+// a permutation of [0, 2^(2 * half_bits))
+static u32 bag_feistel(const struct shuffle_bag* bag, u32 x)
+{
+	u32 mask = BIT(bag->half_bits) - 1;
+	u32 left = x >> bag->half_bits;
+	u32 right = x & mask;
+
+	for(int i = 0; i < BAG_ROUNDS; i++) {
+		u32 next = left ^ (bag_mix(right, bag->keys[i]) & mask);
+		left = right;
+		right = next;
+	}
+
+	return (left << bag->half_bits) | right;
+}
+
+// cycle walking keeps the permutation inside [0, total), the domain is less
+// than four times total so this takes under four steps on average
+static u32 bag_permute(const struct shuffle_bag* bag, u32 n)
+{
+	u32 x = bag_feistel(bag, n);
+	while(x >= bag->total)
+		x = bag_feistel(bag, x);
+
+	return x;
+}
+
+// the next word index from the bag over the words of bank that pass f, or
+// U32_MAX if none does
+static u32 bag_draw(struct shuffle_bag* bag, const struct word_bank* bank,
+                    const struct hangman_word_filter* f)
+{
+	if(bag->bank_gen != bank->gen || memcmp(&bag->filter, f, sizeof(*f)))
+		bag_fill(bag, bank, f);
+
+	if(bag->total == 0)
+		return U32_MAX;
+
+	// the new permutation must not start with the word the old one ended on,
+	// or that word would be drawn twice in a row
+	if(bag->drawn == bag->total) {
+		u32 last = bag_permute(bag, bag->total - 1);
+
+		do {
+			bag_shuffle(bag);
+		} while(bag->total > 1 && bag_permute(bag, 0) == last);
+	}
+
+	return bank_nth(bank, f, bag_permute(bag, bag->drawn++));
+}
+
+// copy what the player can see of game
+// should only be used when game->lock has already been acquired
+void game_view(struct hangman_game* game, struct hangman_view* view)
+{
+	memset(view, 0, sizeof(*view));
+
+	view->revealed_pos = game->revealed_pos;
+	view->guessed_mask = game->guessed_mask;
+	view->secret_len = game->secret_len;
+
+	for(int i = 0; i < game->secret_len; i++) {
+		if(game->revealed_pos & BIT_ULL(i))
+			view->secret[i] = game->secret_str[i];
+	}
+}
+
+// a word of the right length fits view if it has the revealed letters in
+// their places and no guessed letter anywhere else
+static bool word_fits(const char* word, const struct hangman_view* view)
+{
+	for(int i = 0; i < view->secret_len; i++) {
+		char c = word[i];
+
+		if(view->revealed_pos & BIT_ULL(i)) {
+			if(c != view->secret[i])
+				return false;
+		} else if(view->guessed_mask & BIT(c - 'A')) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// count the bank words that fit view and find the unguessed letter that is
+// in the most of them
+//
+// Only the length bucket of the secret is scanned. Most words are rejected by
+// their letter mask alone: a fitting word has every hit letter and no missed
+// one, so only the survivors are compared position by position
+// should only be used under rcu_read_lock()
+void bank_hint(const struct word_bank* bank, const struct hangman_view* view,
+               struct hangman_hint* hint)
+{
+	u32 counts[NUM_LETTERS] = {0};
+	u32 hit_letters = 0;
+	u8 len = view->secret_len;
+
+	memset(hint, 0, sizeof(*hint));
+
+	for(int i = 0; i < len; i++) {
+		if(view->revealed_pos & BIT_ULL(i))
+			hit_letters |= BIT(view->secret[i] - 'A');
+	}
+
+	u32 miss_letters = view->guessed_mask & ~hit_letters;
+	u32 start = bank->key_start[word_key(len, 0)];
+	u32 end = bank->key_start[word_key(len, MAX_DIFFICULTY) + 1];
+
+	for(u32 j = start; j < end; j++) {
+		u32 letters = bank->key_letters[j];
+
+		if((letters & miss_letters) || (letters & hit_letters) != hit_letters)
+			continue;
+
+		if(!word_fits(bank_word(bank, bank->by_key[j]), view))
+			continue;
+
+		hint->candidates++;
+		for(int c = 0; c < NUM_LETTERS; c++)
+			counts[c] += (letters >> c) & 1;
+	}
+
+	u32 best = 0;
+	for(int c = 0; c < NUM_LETTERS; c++) {
+		if(!(view->guessed_mask & BIT(c)) && counts[c] > best) {
+			best = counts[c];
+			hint->letter = 'A' + c;
+		}
+	}
+}
+
+// render state the way read() shows it into out, which must hold
+// OUTPUT_SIZE bytes, and return the length without the '\0'
+size_t render_state(const struct hangman_state* state, char* out)
+{
+	u8 len = min_t(u8, state->secret_len, MAX_WORD_LEN);
+	u8 bad_count = min_t(u8, state->bad_count, NUM_LETTERS);
+	size_t n = 0;
+
+	for(int i = 0; i < len; i++) {
+		out[n++] = state->reveal[i];
+		out[n++] = ' ';
+	}
+	out[n++] = '\n';
+
+	for(int i = 0; i < bad_count; i++) {
+		if(i != 0)
+			out[n++] = ' ';
+
+		out[n++] = state->bad_guesses[i];
+	}
+	out[n++] = '\n';
+
+	n += scnprintf(out + n, OUTPUT_SIZE - n, "%d guesses left\n", state->num_guesses);
+
+	if(state->status == HANGMAN_STATUS_LOST)
+		n += scnprintf(out + n, OUTPUT_SIZE - n, "You Lose!\n");
+	else if(state->status == HANGMAN_STATUS_WON)
+		n += scnprintf(out + n, OUTPUT_SIZE - n, "You Win!\n");
+
+	out[n] = '\0';
+	return n;
+}
+
+// should only be used when game->lock has already been acquired
+void fill_state(struct hangman_game* game, struct hangman_state* state)
+{
+	memset(state, 0, sizeof(*state));
+
+	state->gen = game->gen;
+	state->revealed_pos = game->revealed_pos;
+	state->guessed_mask = game->guessed_mask;
+	state->secret_len = game->secret_len;
+	state->num_guesses = game->num_guesses;
+	state->status = game->status;
+	state->bad_count = game->bad_count;
+
+	for(int i = 0; i < game->secret_len; i++)
+		state->reveal[i] = (game->revealed_pos & BIT_ULL(i)) ? game->secret_str[i] : '-';
+
+	memcpy(state->bad_guesses, game->bad_guesses, game->bad_count);
+}
+
+// called after every change to the game
+// should only be used when game->lock has already been acquired
+static void game_changed(struct hangman_game* game)
+{
+	game->gen++;
+	game_notify(game);
+}
+
+// decode word into round, word need not be '\0' terminated
+static void prepare_round(struct hangman_round* round, const char* word, size_t len)
+{
+	len = min_t(size_t, len, MAX_WORD_LEN);
+
+	memset(round->secret, 0, STR_SIZE);
+	memcpy(round->secret, word, len);
+	round->len = len;
+
+	memset(round->letter_pos, 0, sizeof(round->letter_pos));
+	for(size_t i = 0; i < len; i++) {
+		char c = round->secret[i];
+		if(c >= 'A' && c <= 'Z')
+			round->letter_pos[c - 'A'] |= BIT_ULL(i);
+	}
+
+	round->all_pos = len ? GENMASK_ULL(len - 1, 0) : 0;
+}
+
+// make round's word the game's secret, leaving the guesses alone
+// should only be used when game->lock has already been acquired
+static void load_round(struct hangman_game* game, const struct hangman_round* round)
+{
+	memcpy(game->secret_str, round->secret, STR_SIZE);
+	memcpy(game->letter_pos, round->letter_pos, sizeof(game->letter_pos));
+	game->secret_len = round->len;
+	game->all_pos = round->all_pos;
+}
+
+// clear the guesses of the secret load_round() just loaded and publish the
+// new round
+// should only be used when game->lock has already been acquired
+static void begin_round(struct hangman_game* game)
+{
+	game->revealed_pos = 0;
+	game->guessed_mask = 0;
+	game->bad_count = 0;
+	game->num_guesses = MAX_GUESSES;
+	game->status = HANGMAN_STATUS_PLAYING;
+	game_changed(game);
+
+	count_stat(STAT_GAMES_STARTED);
+}
+
+// should only be used when game->lock has already been acquired
+static void start_round(struct hangman_game* game, const struct hangman_round* round)
+{
+	load_round(game, round);
+	begin_round(game);
+}
+
+// start a new round with word as the secret, word need not be '\0' terminated
+// should only be used when game->lock has already been acquired
+void set_secret(struct hangman_game* game, const char* word, size_t len)
+{
+	struct hangman_round round;
+
+	prepare_round(&round, word, len);
+	start_round(game, &round);
+}
+
+// draw the secret of the game's next round into game->next from the bank
+// words that pass f
+// should only be used when game->next_lock has already been acquired
+static void prepare_next(struct hangman_game* game, const struct word_bank* bank,
+                         const struct hangman_word_filter* f)
+{
+	static const struct hangman_word_filter any_word;
+
+	// the bank may have changed since the filter was set
+	u32 idx = bag_draw(&game->bag, bank, f);
+	if(idx == U32_MAX)
+		idx = bag_draw(&game->bag, bank, &any_word);
+
+	prepare_round(&game->next, bank_word(bank, idx), bank->lengths[idx]);
+	game->next.bank_gen = bank->gen;
+	game->next.filter = *f;
+}
+
+// start a new round with the next word of the game's shuffle bag over the
+// bank words that pass game->filter
+//
+// The secret is normally drawn and decoded ahead of time by
+// prepare_next_round(), so starting the round is a copy. It is only drawn
+// here when none is ready or the bank or filter changed since
+// should only be used when game->lock has already been acquired
+void new_round(struct hangman_game* game, const struct word_bank* bank)
+{
+	spin_lock(&game->next_lock);
+	if(game->next.bank_gen != bank->gen ||
+	   memcmp(&game->next.filter, &game->filter, sizeof(game->filter)))
+		prepare_next(game, bank, &game->filter);
+
+	load_round(game, &game->next);
+	game->next.bank_gen = 0; // used up, the filter is kept for the next one
+	spin_unlock(&game->next_lock);
+
+	begin_round(game);
+}
+
+// draw and decode the secret of the round after the one new_round() last
+// started. The host calls this once it has released game->lock, so the work
+// is off the path of both the restart and any guess waiting for the lock
+// should only be used under rcu_read_lock()
+void prepare_next_round(struct hangman_game* game, const struct word_bank* bank)
+{
+	spin_lock(&game->next_lock);
+	if(game->next.bank_gen == 0)
+		prepare_next(game, bank, &game->next.filter);
+	spin_unlock(&game->next_lock);
+}
+
+// guess must be an uppercase letter
+// should only be used when game->lock has already been acquired
+static bool already_guessed(struct hangman_game* game, char guess)
+{
+	return game->guessed_mask & BIT(guess - 'A');
+}
+
+// guess must be an uppercase letter
+// should only be used when game->lock has already been acquired
+static bool reveal_chars(struct hangman_game* game, char guess)
+{
+	u64 positions = game->letter_pos[guess - 'A'];
+
+	game->guessed_mask |= BIT(guess - 'A');
+	game->revealed_pos |= positions;
+
+	return positions != 0;
+}
+
+// should only be used when game->lock has already been acquired
+static void check_win(struct hangman_game* game)
+{
+	if(game->revealed_pos == game->all_pos)
+		game->status = HANGMAN_STATUS_WON;
+}
+
+static inline bool is_word_sep(char c)
+{
+	return c == ',' || c == '\n' || c == '\r';
+}
+
+int bank_load_init(struct bank_load* load)
+{
+	load->word_len = 0;
+	return bank_builder_init(&load->b) ? 0 : -ENOMEM;
+}
+
+// add the carried word to the bank, if there is one
+static int bank_load_flush(struct bank_load* load)
+{
+	if(load->word_len == 0)
+		return 0;
+
+	size_t len = min_t(size_t, load->word_len, MAX_WORD_LEN);
+	load->word_len = 0;
+	return bank_builder_add(&load->b, load->word, len);
+}
+
+// append part of a word that straddles chunks, anything past MAX_WORD_LEN
+// is only counted since the word gets truncated anyway
+static void bank_load_carry(struct bank_load* load, const char* buf, size_t len)
+{
+	if(load->word_len < MAX_WORD_LEN)
+		memcpy(load->word + load->word_len, buf, min_t(size_t, len, MAX_WORD_LEN - load->word_len));
+
+	load->word_len += len;
+}
+
+int bank_load_feed(struct bank_load* load, const char* buf, size_t len)
+{
+	size_t pos = 0;
+
+	while(pos < len) {
+		size_t start = pos;
+		while(pos < len && !is_word_sep(buf[pos]))
+			pos++;
+
+		// the word may continue in the next chunk
+		if(pos == len) {
+			bank_load_carry(load, buf + start, pos - start);
+			break;
+		}
+
+		int err = 0;
+		if(load->word_len) {
+			bank_load_carry(load, buf + start, pos - start);
+			err = bank_load_flush(load);
+		} else if(pos != start) {
+			err = bank_builder_add(&load->b, buf + start, pos - start);
+		}
+
+		if(err)
+			return err;
+
+		pos++; // move past separator
+	}
+
+	return 0;
+}
+
+// returns the finished bank or an ERR_PTR, load is consumed either way
+struct word_bank* bank_load_finish(struct bank_load* load)
+{
+	int err = bank_load_flush(load);
+	if(!err && load->b.bank->word_count == 0)
+		err = -EINVAL;
+
+	if(err) {
+		bank_builder_abort(&load->b);
+		return ERR_PTR(err);
+	}
+
+	struct word_bank* bank = bank_builder_finish(&load->b);
+	return bank ? bank : ERR_PTR(-ENOMEM);
+}
+
+void bank_load_abort(struct bank_load* load)
+{
+	bank_builder_abort(&load->b);
+}
+
+// record the game in snap, the shuffle bag and the prepared next round are
+// left out, a restored game simply draws new ones
+// should only be used when game->lock has already been acquired
+void game_save(struct hangman_game* game, u32 handle, struct hangman_snapshot_game* snap)
+{
+	memset(snap, 0, sizeof(*snap));
+
+	snap->handle = handle;
+	snap->guessed_mask = game->guessed_mask;
+	snap->filter = game->filter;
+	snap->secret_len = game->secret_len;
+	snap->num_guesses = game->num_guesses;
+	snap->status = game->status;
+	snap->bad_count = game->bad_count;
+	snap->batch = game->batch;
+	memcpy(snap->secret, game->secret_str, game->secret_len);
+	memcpy(snap->bad_guesses, game->bad_guesses, game->bad_count);
+}
+
+// whether snap describes a game that could have been played, snapshots come
+// from userspace and may be made up. The secret must be letters only, so
+// every position can be revealed, and the guesses must agree with the status
+bool snapshot_game_valid(const struct hangman_snapshot_game* snap)
+{
+	u32 letters = 0;
+	u32 bad = 0;
+
+	if(snap->secret_len == 0 || snap->secret_len > MAX_WORD_LEN)
+		return false;
+
+	if(snap->num_guesses > MAX_GUESSES || snap->batch > 1)
+		return false;
+
+	if(snap->guessed_mask & ~(u32)GENMASK_ULL(NUM_LETTERS - 1, 0))
+		return false;
+
+	for(int i = 0; i < snap->secret_len; i++) {
+		char c = snap->secret[i];
+		if(c < 'A' || c > 'Z')
+			return false;
+
+		letters |= BIT(c - 'A');
+	}
+
+	if(snap->secret[snap->secret_len] != '\0')
+		return false;
+
+	// every wrong guess cost one guess and is listed once
+	if(snap->bad_count != MAX_GUESSES - snap->num_guesses)
+		return false;
+
+	for(int i = 0; i < snap->bad_count; i++) {
+		char c = snap->bad_guesses[i];
+		if(c < 'A' || c > 'Z' || (bad & BIT(c - 'A')))
+			return false;
+
+		bad |= BIT(c - 'A');
+	}
+
+	if(bad != (snap->guessed_mask & ~letters))
+		return false;
+
+	u8 status = HANGMAN_STATUS_PLAYING;
+	if(!(letters & ~snap->guessed_mask))
+		status = HANGMAN_STATUS_WON;
+	else if(snap->num_guesses == 0)
+		status = HANGMAN_STATUS_LOST;
+
+	return snap->status == status;
+}
+
+// put the game back in the state saved in snap, which must be valid. The
+// revealed positions follow from the secret and the guessed letters
+// should only be used when game->lock has already been acquired
+void game_restore(struct hangman_game* game, const struct hangman_snapshot_game* snap)
+{
+	struct hangman_round round;
+
+	prepare_round(&round, snap->secret, snap->secret_len);
+	load_round(game, &round);
+
+	game->guessed_mask = snap->guessed_mask;
+	game->revealed_pos = 0;
+	for(int c = 0; c < NUM_LETTERS; c++) {
+		if(game->guessed_mask & BIT(c))
+			game->revealed_pos |= game->letter_pos[c];
+	}
+
+	game->bad_count = snap->bad_count;
+	memcpy(game->bad_guesses, snap->bad_guesses, snap->bad_count);
+	game->num_guesses = snap->num_guesses;
+	game->status = snap->status;
+	game->batch = snap->batch;
+	game->filter = snap->filter;
+	game_changed(game);
+}
+
+long ioctl_read_secret_word(struct hangman_game* game, char* __user buf)
+{
+	if(mutex_lock_interruptible(&game->lock))
+		return -EINTR;
+
+	// Specification says buffer passed to ioctl will be 50 bytes
+	if(copy_to_user(buf, game->secret_str, 50))
+		goto err_unlock;
+
+	mutex_unlock(&game->lock);
+	return 0;
+
+err_unlock:
+	mutex_unlock(&game->lock);
+	return -EFAULT;
+}
+
+long ioctl_write_secret_word(struct hangman_game* game, const char* __user buf)
+{
+	char local_buf[MAX_SECRET_SIZE] = {0};
+	if(copy_from_user(local_buf, buf, MAX_SECRET_SIZE))
+		return -EFAULT;
+
+	for(int i = 0; i < MAX_SECRET_SIZE; i++) {
+		if(local_buf[i] == '\0')
+			break;
+
+		local_buf[i] = toupper(local_buf[i]);
+	}
+
+	// the same rule as bank words, a secret must be one that can be won
+	size_t len = strnlen(local_buf, MAX_SECRET_SIZE);
+	if(!word_playable(local_buf, len))
+		return -EINVAL;
+
+	if(mutex_lock_interruptible(&game->lock))
+		return -EINTR;
+
+	set_secret(game, local_buf, len);
+
+	mutex_unlock(&game->lock);
+	return 0;
+}
+
+// returns the uppercase form of guess, or 0 if it isn't a letter
+char normalize_guess(char guess)
+{
+	if(!isalpha(guess))
+		return 0;
+
+	// isalpha() also accepts Latin-1 letters, which have no bit in the masks
+	guess = toupper(guess);
+	if(guess < 'A' || guess > 'Z')
+		return 0;
+
+	return guess;
+}
+
+// apply one uppercase letter without publishing the change
+// should only be used when game->lock has already been acquired
+static u8 guess_letter(struct hangman_game* game, char guess)
+{
+	count_stat(STAT_GUESSES);
+
+	if(already_guessed(game, guess))
+		return HANGMAN_GUESS_REPEAT;
+
+	bool found_char = reveal_chars(game, guess);
+	if(!found_char) {
+		if(--game->num_guesses == 0) {
+			game->status = HANGMAN_STATUS_LOST;
+			count_stat(STAT_GAMES_LOST);
+		}
+
+		game->bad_guesses[game->bad_count++] = guess;
+	} else {
+		check_win(game);
+		if(game->status == HANGMAN_STATUS_WON)
+			count_stat(STAT_GAMES_WON);
+	}
+
+	return found_char ? HANGMAN_GUESS_HIT : HANGMAN_GUESS_MISS;
+}
+
+// apply one uppercase letter to a game that is still being played and
+// return a HANGMAN_GUESS_* outcome
+// should only be used when game->lock has already been acquired
+u8 apply_guess(struct hangman_game* game, char guess)
+{
+	u8 result = guess_letter(game, guess);
+
+	if(result != HANGMAN_GUESS_REPEAT)
+		game_changed(game);
+
+	return result;
+}
+
+// apply count uppercase letters in order, keeping the outcome of each in
+// game->batch_result, returns -EFAULT if the game was already over. The
+// letters are published as a single change
+// should only be used when game->lock has already been acquired
+int play_guesses(struct hangman_game* game, const char* guesses, size_t count)
+{
+	if(game->status != HANGMAN_STATUS_PLAYING)
+		return -EFAULT;
+
+	struct hangman_batch_result* result = &game->batch_result;
+	bool changed = false;
+	result->count = count;
+
+	for(size_t i = 0; i < count; i++) {
+		if(game->status != HANGMAN_STATUS_PLAYING) {
+			result->results[i] = HANGMAN_GUESS_SKIPPED;
+			continue;
+		}
+
+		result->results[i] = guess_letter(game, guesses[i]);
+		if(result->results[i] != HANGMAN_GUESS_REPEAT)
+			changed = true;
+	}
+
+	if(changed)
+		game_changed(game);
+
+	return 0;
+}
+
+long ioctl_get_state(struct hangman_game* game, void* __user buf)
+{
+	struct hangman_state state;
+
+	if(mutex_lock_interruptible(&game->lock))
+		return -EINTR;
+
+	fill_state(game, &state);
+	WRITE_ONCE(game->read_gen, game->gen);
+	mutex_unlock(&game->lock);
+
+	if(copy_to_user(buf, &state, sizeof(state)))
+		return -EFAULT;
+
+	return 0;
+}
+
+long ioctl_set_batch(struct hangman_game* game, int __user* arg)
+{
+	int enable;
+	if(get_user(enable, arg))
+		return -EFAULT;
+
+	WRITE_ONCE(game->batch, enable != 0);
+	return 0;
+}
+
+long ioctl_batch_result(struct hangman_game* game, void* __user buf)
+{
+	struct hangman_batch_result result;
+
+	if(mutex_lock_interruptible(&game->lock))
+		return -EINTR;
+
+	memcpy(&result, &game->batch_result, offsetof(struct hangman_batch_result, results));
+	memset(result.results, 0, sizeof(result.results));
+	memcpy(result.results, game->batch_result.results, result.count);
+	mutex_unlock(&game->lock);
+
+	if(copy_to_user(buf, &result, sizeof(result)))
+		return -EFAULT;
+
+	return 0;
+}
@@ -0,0 +1,247 @@
+#ifndef HANGMAN_CORE_H
+#define HANGMAN_CORE_H
+// The game engine and word bank, independent of the character device.
+//
+// hangman_core.c builds both into the module and, through hangman_shim.h,
+// into a userspace library so the engine can be tested and benchmarked
+// without loading the module. The few things the engine needs from its host
+// are the hooks at the bottom of this file
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/limits.h>
+#include <linux/random.h>
+#include <linux/ctype.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/rcupdate.h>
+#include <linux/slab.h>
+#include <linux/overflow.h>
+#include <linux/bits.h>
+#include <linux/bitops.h>
+#include <linux/mm.h>
+#include <linux/err.h>
+#include <linux/wait.h>
+#include <linux/kref.h>
+#include <linux/uaccess.h>
+#include <linux/atomic.h>
+#include <linux/cache.h>
+#include <linux/seqlock.h>
+#else
+#include "hangman_shim.h"
+#endif
+
+#include "hangman_uapi.h"
+
+#define STR_SIZE 64
+#define MAX_WORD_LEN HANGMAN_MAX_WORD_LEN
+#define OUTPUT_SIZE (STR_SIZE * 4)
+#define NUM_LETTERS HANGMAN_NUM_LETTERS
+#define MAX_BATCH_SIZE HANGMAN_MAX_BATCH
+#define MAX_DIFFICULTY NUM_LETTERS
+#define MAX_GUESSES 10
+// words are indexed by (length, difficulty), see word_key()
+#define NUM_WORD_KEYS ((MAX_WORD_LEN + 1) * (MAX_DIFFICULTY + 1))
+
+// Event counters, see count_stat()
+enum hangman_stat {
+	STAT_GAMES_STARTED,
+	STAT_GAMES_WON,
+	STAT_GAMES_LOST,
+	STAT_GUESSES,
+	STAT_BAD_WRITES,
+	STAT_READS,
+	STAT_RESTARTS,
+	STAT_BANK_RELOADS,
+	NR_STATS,
+};
+
+// A secret decoded ahead of time, so starting its round is a copy
+struct hangman_round {
+	u64 bank_gen;			// bank the word was drawn from, 0 if none is ready
+	struct hangman_word_filter filter;	// game->filter when it was drawn
+	u64 letter_pos[NUM_LETTERS];
+	u64 all_pos;
+	u8 len;
+	char secret[STR_SIZE];
+};
+
+#define BAG_ROUNDS 4
+
+// The order in which a game draws bank words. The words that pass the filter
+// are numbered 0 to total - 1 and drawn in the order of a random permutation,
+// so none repeats before all of them have been played. The permutation is a
+// small Feistel network over the next power of four, walked until it lands
+// below total, so it takes no memory whatever the size of the bank
+struct shuffle_bag {
+	u64 bank_gen;			// bank the permutation is over, 0 if none
+	struct hangman_word_filter filter;	// filter it was built for
+	u32 total;			// words that pass filter
+	u32 drawn;			// words drawn since the last shuffle
+	u8 half_bits;			// the network works on 2 * half_bits bits
+	u32 keys[BAG_ROUNDS];
+};
+
+// A single game of hangman. Every open file descriptor has a session with
+// one game played through read/write, plus any number of extra games that
+// are created and played by handle through ioctls
+//
+// Guesses are tracked as bitmasks: letter_pos[c - 'A'] has bit i set when
+// secret_str[i] is c, so revealing a letter or checking for a win is a few
+// bit operations. game_notify() copies what a player can see into state
+// under state_seq, once per write however many letters it held, and read()
+// and llseek() copy that and render it with render_state() without the lock
+//
+// The whole game is one object with its buffers embedded, allocated from a
+// dedicated slab cache by the module. What a guess touches comes first, so
+// the lock and the state it protects share the first cache lines, and the
+// rarely used fields come last
+struct hangman_game {
+	struct mutex lock;
+	u64 gen;			// bumped by game_changed()
+	u64 revealed_pos;		// positions of secret_str uncovered so far
+	u64 all_pos;			// one bit per character of secret_str
+	u32 guessed_mask;		// bit (c - 'A') is set once c was guessed
+	u8 bad_count;
+	u8 secret_len;
+	u8 num_guesses;
+	u8 status;
+	u64 letter_pos[NUM_LETTERS];
+	char bad_guesses[NUM_LETTERS];	// wrong letters in the order guessed
+	bool batch;			// write() takes a string of letters
+	char secret_str[STR_SIZE];
+
+	seqcount_t state_seq;		// written under lock, covers state
+	struct hangman_state state;	// filled by the host in game_notify()
+	u64 read_gen;			// gen last handed to the reader
+
+	struct hangman_batch_result batch_result;
+	struct hangman_shared_state* shared;	// page handed out by mmap, if any
+	wait_queue_head_t wait;		// woken by game_notify()
+	struct hangman_word_filter filter;	// which bank words new rounds draw from
+	spinlock_t next_lock;		// covers bag and next, nests inside lock
+	struct shuffle_bag bag;
+	struct hangman_round next;	// secret of the next round, see new_round()
+	struct kref ref;		// only games in a session's handle table are shared
+	struct rcu_head rcu;
+} ____cacheline_aligned;
+
+// An immutable snapshot of the word bank. Readers find the current one
+// through word_bank under rcu_read_lock(), writers build a new bank with a
+// word_bank_builder and swap it in with publish_word_bank()
+//
+// Words are packed back to back in arena, each followed by a ',', and found
+// through offsets/lengths so memory grows with the real size of the words.
+// The parser splits words on ',', so the arena minus its last ',' is also the
+// serialized bank handed out by HANGMAN_IOC_READ_BANK and
+// HANGMAN_IOC_BANK_READ, built once per bank and tagged with gen
+//
+// by_key lists every word index sorted by word_key(), and the words with key
+// k are by_key[key_start[k]] to by_key[key_start[k + 1] - 1], so a range of
+// lengths and difficulties maps to one contiguous span per length
+//
+// key_letters[j] is the letter mask of word by_key[j], in the same order so
+// scanning all words of one length reads a single run of memory
+struct word_bank {
+	struct rcu_head rcu;
+	struct kref ref;		// held by word_bank and by readers outside RCU
+	u64 gen;			// unique to this bank, never 0
+	bool builtin;			// made by alloc_default_bank()
+	u32 word_count;
+	u32 arena_len;
+	u32* offsets;
+	u8* lengths;
+	char* arena;
+	u32* by_key;
+	u32* key_start;
+	u32* key_letters;
+};
+
+static inline const char* bank_word(const struct word_bank* bank, u32 idx)
+{
+	return bank->arena + bank->offsets[idx];
+}
+
+// length of the serialized bank at arena, the words joined by ','
+static inline u32 bank_text_len(const struct word_bank* bank)
+{
+	return bank->arena_len ? bank->arena_len - 1 : 0;
+}
+
+// Grows a word_bank that no reader can see yet
+struct word_bank_builder {
+	struct word_bank* bank;
+	u32 word_cap;
+	u32 arena_cap;
+};
+
+// Incremental parser for a new word bank. Words are separated by ',' or
+// '\n' and may be split across any number of chunks. Complete words are
+// added straight from the chunk, only a word that straddles two chunks is
+// carried over in word
+struct bank_load {
+	struct word_bank_builder b;
+	size_t word_len;		// length of the carried word, may exceed MAX_WORD_LEN
+	char word[MAX_WORD_LEN];
+};
+
+// Limits on the size of any one bank, so an unprivileged client cannot load
+// an unbounded one. The module exposes them as parameters
+extern u32 bank_max_words;
+extern u32 bank_max_bytes;		// of words and their separators
+
+void free_word_bank(struct word_bank* bank);
+bool bank_builder_init(struct word_bank_builder* b);
+int bank_builder_add(struct word_bank_builder* b, const char* word, size_t len);
+struct word_bank* bank_builder_finish(struct word_bank_builder* b);
+void bank_builder_abort(struct word_bank_builder* b);
+struct word_bank* alloc_default_bank(void);
+u32 bank_count(const struct word_bank* bank, const struct hangman_word_filter* f);
+
+// What a player can see of a game, enough to find the words it could be
+struct hangman_view {
+	u64 revealed_pos;
+	u32 guessed_mask;
+	u8 secret_len;
+	char secret[MAX_WORD_LEN];	// only the revealed positions are set
+};
+
+void game_view(struct hangman_game* game, struct hangman_view* view);
+void bank_hint(const struct word_bank* bank, const struct hangman_view* view,
+               struct hangman_hint* hint);
+
+int bank_load_init(struct bank_load* load);
+int bank_load_feed(struct bank_load* load, const char* buf, size_t len);
+struct word_bank* bank_load_finish(struct bank_load* load);
+void bank_load_abort(struct bank_load* load);
+
+void set_secret(struct hangman_game* game, const char* word, size_t len);
+void new_round(struct hangman_game* game, const struct word_bank* bank);
+void prepare_next_round(struct hangman_game* game, const struct word_bank* bank);
+size_t render_state(const struct hangman_state* state, char* out);
+void fill_state(struct hangman_game* game, struct hangman_state* state);
+char normalize_guess(char guess);
+u8 apply_guess(struct hangman_game* game, char guess);
+int play_guesses(struct hangman_game* game, const char* guesses, size_t count);
+
+void game_save(struct hangman_game* game, u32 handle, struct hangman_snapshot_game* snap);
+bool snapshot_game_valid(const struct hangman_snapshot_game* snap);
+void game_restore(struct hangman_game* game, const struct hangman_snapshot_game* snap);
+
+long ioctl_read_secret_word(struct hangman_game* game, char* __user buf);
+long ioctl_write_secret_word(struct hangman_game* game, const char* __user buf);
+long ioctl_get_state(struct hangman_game* game, void* __user buf);
+long ioctl_set_batch(struct hangman_game* game, int __user* arg);
+long ioctl_batch_result(struct hangman_game* game, void* __user buf);
+
+// Hooks implemented by the host, the module or a userspace program
+
+// count one event of the given kind
+void count_stat(enum hangman_stat stat);
+
+// called with game->lock held after every change to the game, once gen has
+// been bumped. A write of several letters is one change
+void game_notify(struct hangman_game* game);
+
+#endif
@@ -0,0 +1,1452 @@
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/string.h>
+#include <linux/limits.h>
+#include <linux/random.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/ctype.h>
+#include <linux/mutex.h>
+#include <linux/rcupdate.h>
+#include <linux/slab.h>
+#include <linux/overflow.h>
+#include <linux/bits.h>
+#include <linux/bitops.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/uio.h>
+#include <linux/xarray.h>
+#include <linux/kref.h>
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched/signal.h>
+#include <linux/preempt.h>
+
+#include "hangman_core.h"
+
+#define CREATE_TRACE_POINTS
+#include "hangman_trace.h"
+
+MODULE_LICENSE("GPL");
+
+#define MAX_DEVICES 64
+
+static unsigned int num_devices = 1;
+module_param(num_devices, uint, 0444);
+MODULE_PARM_DESC(num_devices, "number of device nodes, each with its own word bank: "
+                 "/dev/hangman for 1, /dev/hangman0 to /dev/hangmanN-1 otherwise");
+
+module_param(bank_max_words, uint, 0644);
+MODULE_PARM_DESC(bank_max_words, "most words a loaded word bank may hold");
+module_param(bank_max_bytes, uint, 0644);
+MODULE_PARM_DESC(bank_max_bytes, "most bytes of words a loaded word bank may hold");
+
+// handles run from 1 to session_max_games, so it bounds the games per session
+static unsigned int session_max_games = 1024;
+module_param(session_max_games, uint, 0644);
+MODULE_PARM_DESC(session_max_games, "most games one open file may create by handle");
+
+// Event counters, kept per CPU so counting never bounces a shared cache line.
+// The sums are shown in <debugfs>/hangman/stats as "name value" lines
+static const char* const stat_names[NR_STATS] = {
+	[STAT_GAMES_STARTED] = "games_started",
+	[STAT_GAMES_WON] = "games_won",
+	[STAT_GAMES_LOST] = "games_lost",
+	[STAT_GUESSES] = "guesses",
+	[STAT_BAD_WRITES] = "bad_writes",
+	[STAT_READS] = "reads",
+	[STAT_RESTARTS] = "restarts",
+	[STAT_BANK_RELOADS] = "bank_reloads",
+};
+
+struct hangman_stats {
+	u64 count[NR_STATS];
+};
+
+static DEFINE_PER_CPU(struct hangman_stats, hangman_stats);
+
+void count_stat(enum hangman_stat stat)
+{
+	this_cpu_inc(hangman_stats.count[stat]);
+}
+
+static struct dentry* hangman_debugfs;
+
+// One device node. Its sessions play from, load and read its own word bank,
+// so players can be partitioned across nodes that never touch each other's
+// banks. Games always belong to a session
+struct hangman_device {
+	struct miscdevice md;
+	struct word_bank __rcu* word_bank;
+	struct mutex word_bank_lock;	// serializes writers of word_bank, readers never take it
+	char name[16];
+};
+
+static struct hangman_device* devices;
+
+// stored in file->private_data
+struct hangman_session {
+	struct hangman_device* dev;	// node the session was opened on
+	struct hangman_game* game;	// the game played through read/write
+	struct xarray games;		// handle -> struct hangman_game*
+	struct bank_load* bank_load;	// word bank being streamed in, if any
+	struct mutex load_lock;		// protects bank_load
+};
+
+static inline struct hangman_game* file_game(struct file* file)
+{
+	struct hangman_session* session = file->private_data;
+	return session->game;
+}
+
+// every struct hangman_game comes from here
+static struct kmem_cache* game_cache;
+
+static void free_word_bank_rcu(struct rcu_head* head)
+{
+	free_word_bank(container_of(head, struct word_bank, rcu));
+}
+
+// RCU readers may still be looking at the bank when the last reference goes
+static void release_word_bank(struct kref* ref)
+{
+	struct word_bank* bank = container_of(ref, struct word_bank, ref);
+	call_rcu(&bank->rcu, free_word_bank_rcu);
+}
+
+// take a reference on the device's current bank, for readers that copy from
+// it to userspace and so cannot stay in an RCU read section
+static struct word_bank* get_word_bank(struct hangman_device* dev)
+{
+	struct word_bank* bank;
+
+	// a bank whose last reference is gone has already been replaced
+	rcu_read_lock();
+	do {
+		bank = rcu_dereference(dev->word_bank);
+	} while(!kref_get_unless_zero(&bank->ref));
+	rcu_read_unlock();
+
+	return bank;
+}
+
+static void put_word_bank(struct word_bank* bank)
+{
+	kref_put(&bank->ref, release_word_bank);
+}
+
+// make bank the device's word bank, the old one is freed after a grace period
+static void publish_word_bank(struct hangman_device* dev, struct word_bank* bank)
+{
+	kref_init(&bank->ref);
+
+	mutex_lock(&dev->word_bank_lock);
+	struct word_bank* old = rcu_replace_pointer(dev->word_bank, bank,
+	                                            lockdep_is_held(&dev->word_bank_lock));
+	mutex_unlock(&dev->word_bank_lock);
+
+	if(old)
+		put_word_bank(old);
+
+	count_stat(STAT_BANK_RELOADS);
+}
+
+// copy the game into the mmap'd page, userspace reads it locklessly so the
+// update is wrapped in a seqcount
+// should only be used when game->lock has already been acquired
+static void publish_shared_state(struct hangman_game* game)
+{
+	struct hangman_shared_state* shared = game->shared;
+	u32 seq = shared->seq;
+
+	WRITE_ONCE(shared->seq, seq + 1);
+	smp_wmb();
+
+	shared->state = game->state;
+
+	smp_wmb();
+	WRITE_ONCE(shared->seq, seq + 2);
+}
+
+// publish the change to read(), mmap readers and anyone polling the game
+// should only be used when game->lock has already been acquired
+void game_notify(struct hangman_game* game)
+{
+	// only copy the state here, readers render it themselves. state_seq is a
+	// plain seqcount_t so readers never take the lock, not even on PREEMPT_RT,
+	// which in turn means its writers must not be preempted
+	preempt_disable();
+	write_seqcount_begin(&game->state_seq);
+	fill_state(game, &game->state);
+	write_seqcount_end(&game->state_seq);
+	preempt_enable();
+
+	if(game->shared)
+		publish_shared_state(game);
+
+	wake_up_interruptible_poll(&game->wait, EPOLLIN | EPOLLRDNORM);
+}
+
+// game->lock must be locked before calling init_game
+static void init_game(struct hangman_device* dev, struct hangman_game* game)
+{
+	rcu_read_lock();
+	struct word_bank* bank = rcu_dereference(dev->word_bank);
+	new_round(game, bank);
+	u64 bank_gen = bank->gen;
+	rcu_read_unlock();
+
+	trace_hangman_init_game(game, game->secret_len, bank_gen);
+}
+
+// start the game's next round in place
+// game->lock must be locked before calling restart_game
+static void restart_game(struct hangman_device* dev, struct hangman_game* game)
+{
+	init_game(dev, game);
+	count_stat(STAT_RESTARTS);
+}
+
+// draw the secret after the round just started, called once game->lock is
+// released so nobody waits on it for the work
+static void prepare_game(struct hangman_device* dev, struct hangman_game* game)
+{
+	rcu_read_lock();
+	prepare_next_round(game, rcu_dereference(dev->word_bank));
+	rcu_read_unlock();
+}
+
+// the bank is copied straight from its arena, which already holds the words
+// joined by ','
+static long ioctl_read_word_bank(struct hangman_device* dev, char* __user buf)
+{
+	struct word_bank* bank = get_word_bank(dev);
+	long ret = 0;
+
+	// Specification says buffer passed to ioctl will be 500 bytes
+	if(copy_to_user(buf, bank->arena, min_t(u32, bank_text_len(bank), MAX_BANK_SIZE)))
+		ret = -EFAULT;
+
+	put_word_bank(bank);
+	return ret;
+}
+
+static long ioctl_bank_read(struct hangman_device* dev, struct hangman_bank_read __user* arg)
+{
+	struct hangman_bank_read req;
+	if(copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	if(req.flags & ~HANGMAN_BANK_READ_IF_CHANGED)
+		return -EINVAL;
+
+	bool if_changed = req.flags & HANGMAN_BANK_READ_IF_CHANGED;
+	struct word_bank* bank = get_word_bank(dev);
+	u32 total = bank_text_len(bank);
+	long ret = 0;
+
+	// bank generations are never 0, so gen 0 matches no bank
+	if(req.gen && req.gen != bank->gen && !if_changed) {
+		ret = -ESTALE;
+		goto out;
+	}
+
+	if(if_changed && req.gen == bank->gen) {
+		req.len = 0;
+	} else {
+		u32 offset = min_t(u32, req.offset, total);
+		req.len = min_t(u32, req.len, total - offset);
+
+		if(copy_to_user(u64_to_user_ptr(req.data), bank->arena + offset, req.len)) {
+			ret = -EFAULT;
+			goto out;
+		}
+	}
+
+	req.gen = bank->gen;
+	req.total = total;
+	if(copy_to_user(arg, &req, sizeof(req)))
+		ret = -EFAULT;
+out:
+	put_word_bank(bank);
+	return ret;
+}
+
+static long ioctl_write_word_bank(struct hangman_device* dev, const char* __user buf)
+{
+	char local_buf[MAX_BANK_SIZE];
+	struct bank_load load;
+
+	// Specification says buffer passed to ioctl will be 500 bytes
+	if(copy_from_user(local_buf, buf, MAX_BANK_SIZE))
+		return -EFAULT;
+
+	size_t len = strnlen(local_buf, MAX_BANK_SIZE);
+	u32 word_count = 0;
+
+	// build the new bank off to the side so readers never see it half parsed
+	int err = bank_load_init(&load);
+	if(err)
+		goto out;
+
+	err = bank_load_feed(&load, local_buf, len);
+	if(err) {
+		bank_load_abort(&load);
+		goto out;
+	}
+
+	struct word_bank* bank = bank_load_finish(&load);
+	if(IS_ERR(bank)) {
+		err = PTR_ERR(bank);
+		goto out;
+	}
+
+	word_count = bank->word_count;
+	publish_word_bank(dev, bank);
+out:
+	trace_hangman_write_bank(len, word_count, err);
+	return err;
+}
+
+// A bank of any size can be streamed in with HANGMAN_IOC_BANK_BEGIN, any
+// number of HANGMAN_IOC_BANK_APPEND chunks and HANGMAN_IOC_BANK_COMMIT, which
+// swaps the whole bank in at once. Each session has at most one load going
+static long ioctl_bank_begin(struct hangman_session* session)
+{
+	struct bank_load* load = kmalloc(sizeof(*load), GFP_KERNEL_ACCOUNT);
+	if(!load)
+		return -ENOMEM;
+
+	int err = bank_load_init(load);
+	if(err) {
+		kfree(load);
+		return err;
+	}
+
+	if(mutex_lock_interruptible(&session->load_lock)) {
+		bank_load_abort(load);
+		kfree(load);
+		return -EINTR;
+	}
+
+	// starting over drops whatever was loaded so far
+	swap(session->bank_load, load);
+	mutex_unlock(&session->load_lock);
+
+	if(load) {
+		bank_load_abort(load);
+		kfree(load);
+	}
+
+	return 0;
+}
+
+static long ioctl_bank_append(struct hangman_session* session, const struct hangman_bank_chunk __user* arg)
+{
+	struct hangman_bank_chunk chunk;
+	if(copy_from_user(&chunk, arg, sizeof(chunk)))
+		return -EFAULT;
+
+	const char __user* data = u64_to_user_ptr(chunk.data);
+
+	// chunks are copied through one page at a time
+	char* buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if(!buf)
+		return -ENOMEM;
+
+	long ret = 0;
+	if(mutex_lock_interruptible(&session->load_lock)) {
+		ret = -EINTR;
+		goto out_free;
+	}
+
+	if(!session->bank_load) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	for(u32 done = 0; done < chunk.len;) {
+		if(fatal_signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+
+		size_t len = min_t(size_t, chunk.len - done, PAGE_SIZE);
+		if(copy_from_user(buf, data + done, len)) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = bank_load_feed(session->bank_load, buf, len);
+		if(ret)
+			break;
+
+		done += len;
+	}
+
+	// a failed append leaves the load in an unknown state, so drop it
+	if(ret) {
+		bank_load_abort(session->bank_load);
+		kfree(session->bank_load);
+		session->bank_load = NULL;
+	}
+
+out_unlock:
+	mutex_unlock(&session->load_lock);
+out_free:
+	kfree(buf);
+	return ret;
+}
+
+static long ioctl_bank_commit(struct hangman_session* session)
+{
+	if(mutex_lock_interruptible(&session->load_lock))
+		return -EINTR;
+
+	struct bank_load* load = session->bank_load;
+	session->bank_load = NULL;
+	mutex_unlock(&session->load_lock);
+
+	if(!load)
+		return -EINVAL;
+
+	struct word_bank* bank = bank_load_finish(load);
+	kfree(load);
+
+	if(IS_ERR(bank))
+		return PTR_ERR(bank);
+
+	publish_word_bank(session->dev, bank);
+	return 0;
+}
+
+static long ioctl_bank_abort(struct hangman_session* session)
+{
+	if(mutex_lock_interruptible(&session->load_lock))
+		return -EINTR;
+
+	struct bank_load* load = session->bank_load;
+	session->bank_load = NULL;
+	mutex_unlock(&session->load_lock);
+
+	if(!load)
+		return -EINVAL;
+
+	bank_load_abort(load);
+	kfree(load);
+	return 0;
+}
+
+static long ioctl_restart(struct file* file)
+{
+	struct hangman_session* session = file->private_data;
+	struct hangman_game* game = session->game;
+
+	if(mutex_lock_interruptible(&game->lock))
+		return -EINTR;
+
+	// a bank that is already the default one is as good as a new copy
+	rcu_read_lock();
+	bool reset_bank = !rcu_dereference(session->dev->word_bank)->builtin;
+	rcu_read_unlock();
+
+	if(reset_bank) {
+		struct word_bank* bank = alloc_default_bank();
+		if(!bank) {
+			mutex_unlock(&game->lock);
+			return -ENOMEM;
+		}
+
+		publish_word_bank(session->dev, bank);
+	}
+
+	restart_game(session->dev, game);
+    file->f_pos = 0;
+
+	mutex_unlock(&game->lock);
+	prepare_game(session->dev, game);
+
+	return 0;
+}
+
+static struct hangman_game* alloc_game(struct hangman_device* dev)
+{
+	struct hangman_game* game = kmem_cache_zalloc(game_cache, GFP_KERNEL);
+	if(!game)
+		return NULL;
+
+	mutex_init(&game->lock);
+	spin_lock_init(&game->next_lock);
+	seqcount_init(&game->state_seq);
+	init_waitqueue_head(&game->wait);
+	kref_init(&game->ref);
+
+	// nobody else can see the game yet, the lock is only taken because
+	// game_notify() expects it
+	mutex_lock(&game->lock);
+	init_game(dev, game);
+	mutex_unlock(&game->lock);
+
+	prepare_game(dev, game);
+	return game;
+}
+
+static void free_game_rcu(struct rcu_head* head)
+{
+	kmem_cache_free(game_cache, container_of(head, struct hangman_game, rcu));
+}
+
+static void release_game(struct kref* ref)
+{
+	struct hangman_game* game = container_of(ref, struct hangman_game, ref);
+
+	vfree(game->shared);
+	mutex_destroy(&game->lock);
+
+	// lookups in the handle table may still be looking at game->ref
+	call_rcu(&game->rcu, free_game_rcu);
+}
+
+static void put_game(struct hangman_game* game)
+{
+	kref_put(&game->ref, release_game);
+}
+
+static int hangman_open(struct inode* inode, struct file* file)
+{
+	// misc_open() leaves the miscdevice in private_data
+	struct hangman_device* dev = container_of(file->private_data, struct hangman_device, md);
+
+	struct hangman_session* session = kzalloc(sizeof(*session), GFP_KERNEL);
+	if(!session)
+		return -ENOMEM;
+
+	session->dev = dev;
+	session->game = alloc_game(dev);
+	if(!session->game) {
+		kfree(session);
+		return -ENOMEM;
+	}
+
+	// handle 0 is never handed out
+	xa_init_flags(&session->games, XA_FLAGS_ALLOC1);
+	mutex_init(&session->load_lock);
+	file->private_data = session;
+
+	// let io_uring try IOCB_NOWAIT first instead of punting to a worker
+	file->f_mode |= FMODE_NOWAIT;
+	return 0;
+}
+
+static int hangman_release(struct inode* inode, struct file* file)
+{
+	struct hangman_session* session = file->private_data;
+	struct hangman_game* game;
+	unsigned long handle;
+
+	xa_for_each(&session->games, handle, game) {
+		xa_erase(&session->games, handle);
+		put_game(game);
+	}
+
+	xa_destroy(&session->games);
+	put_game(session->game);
+
+	if(session->bank_load) {
+		bank_load_abort(session->bank_load);
+		kfree(session->bank_load);
+	}
+
+	mutex_destroy(&session->load_lock);
+	kfree(session);
+
+	return 0;
+}
+
+// IOCB_NOWAIT callers get -EAGAIN instead of sleeping on a contended lock
+static int lock_game(struct hangman_game* game, struct kiocb* iocb)
+{
+	if(iocb->ki_flags & IOCB_NOWAIT)
+		return mutex_trylock(&game->lock) ? 0 : -EAGAIN;
+
+	return mutex_lock_interruptible(&game->lock) ? -EINTR : 0;
+}
+
+// copy the state published by game_notify() without taking game->lock,
+// retrying if it was published again meanwhile, and render it into buf,
+// which must hold OUTPUT_SIZE bytes
+static size_t render_game(struct hangman_game* game, char* buf, u64* gen)
+{
+	struct hangman_state state;
+	unsigned int seq;
+
+	do {
+		seq = read_seqcount_begin(&game->state_seq);
+		state = game->state;
+	} while(read_seqcount_retry(&game->state_seq, seq));
+
+	if(gen)
+		*gen = state.gen;
+
+	return render_state(&state, buf);
+}
+
+// never sleeps on the game, so IOCB_NOWAIT needs no special handling
+static ssize_t read_game(struct kiocb* iocb, struct iov_iter* to)
+{
+	struct hangman_game* game = file_game(iocb->ki_filp);
+	char buf[OUTPUT_SIZE];
+	u64 gen;
+
+	size_t len = render_game(game, buf, &gen);
+
+	if(iocb->ki_pos < 0 || iocb->ki_pos > len)
+		return -EINVAL;
+
+	size_t count = min_t(size_t, len - iocb->ki_pos, iov_iter_count(to));
+	size_t copied = copy_to_iter(buf + iocb->ki_pos, count, to);
+	WRITE_ONCE(game->read_gen, gen);
+
+	if(count && !copied)
+		return -EFAULT;
+
+	count_stat(STAT_READS);
+	iocb->ki_pos += copied;
+	return copied;
+}
+
+static ssize_t hangman_read_iter(struct kiocb* iocb, struct iov_iter* to)
+{
+	loff_t pos = iocb->ki_pos;
+	size_t bytes = iov_iter_count(to);
+
+	ssize_t ret = read_game(iocb, to);
+	trace_hangman_read(file_game(iocb->ki_filp), pos, bytes, ret);
+	return ret;
+}
+
+// A write normally holds one 2-byte guess, a letter and a '\0' or '\n'. A
+// vectored write (writev or io_uring) of several 2-byte guesses back to back
+// is applied in order under one lock hold.
+//
+// In batch mode a write is instead a string of letters, optionally ended by
+// '\0' or '\n'.
+//
+// Guesses after the game is won or lost are skipped, and the outcome of each
+// guess is kept for HANGMAN_IOC_BATCH_RESULT
+static ssize_t write_guesses(struct kiocb* iocb, struct iov_iter* from)
+{
+	struct hangman_game* game = file_game(iocb->ki_filp);
+	char buf[MAX_BATCH_SIZE * 2];
+	char guesses[MAX_BATCH_SIZE];
+	size_t size = iov_iter_count(from);
+	size_t count = 0;
+	bool batch = READ_ONCE(game->batch);
+
+	if(batch) {
+		if(size == 0 || size > MAX_BATCH_SIZE)
+			return -EFAULT;
+	} else if(size == 0 || size % 2 != 0 || size > sizeof(buf)) {
+		return -EFAULT;
+	}
+
+	if(copy_from_iter(buf, size, from) != size)
+		return -EFAULT;
+
+	// validate every guess first so a bad letter changes nothing
+	if(batch) {
+		while(count < size && buf[count] != '\0' && buf[count] != '\n') {
+			guesses[count] = buf[count];
+			count++;
+		}
+	} else {
+		// every guess is a letter and a terminator, "ABCD" is not two guesses
+		for(; count < size / 2; count++) {
+			char end = buf[count * 2 + 1];
+			if(end != '\0' && end != '\n')
+				return -EFAULT;
+
+			guesses[count] = buf[count * 2];
+		}
+	}
+
+	if(count == 0)
+		return -EFAULT;
+
+	for(size_t i = 0; i < count; i++) {
+		guesses[i] = normalize_guess(guesses[i]);
+		if(!guesses[i])
+			return -EFAULT;
+	}
+
+	int err = lock_game(game, iocb);
+	if(err)
+		return err;
+
+	err = play_guesses(game, guesses, count);
+	mutex_unlock(&game->lock);
+	if(err)
+		return err;
+
+	iocb->ki_pos = 0;
+	return size;
+}
+
+static ssize_t hangman_write_iter(struct kiocb* iocb, struct iov_iter* from)
+{
+	loff_t pos = iocb->ki_pos;
+	size_t bytes = iov_iter_count(from);
+
+	ssize_t ret = write_guesses(iocb, from);
+	if(ret == -EFAULT)
+		count_stat(STAT_BAD_WRITES);
+
+	trace_hangman_write(file_game(iocb->ki_filp), pos, bytes, ret);
+	return ret;
+}
+
+// returns the game for handle with a reference held, or NULL
+static struct hangman_game* get_handle_game(struct hangman_session* session, u32 handle)
+{
+	rcu_read_lock();
+	struct hangman_game* game = xa_load(&session->games, handle);
+	if(game && !kref_get_unless_zero(&game->ref))
+		game = NULL;
+	rcu_read_unlock();
+
+	return game;
+}
+
+static long ioctl_game_create(struct hangman_session* session, __u32 __user* arg)
+{
+	u32 handle;
+
+	struct hangman_game* game = alloc_game(session->dev);
+	if(!game)
+		return -ENOMEM;
+
+	// new games draw from the same words as the session's own game
+	if(mutex_lock_interruptible(&session->game->lock)) {
+		put_game(game);
+		return -EINTR;
+	}
+
+	game->filter = session->game->filter;
+	mutex_unlock(&session->game->lock);
+
+	int err = xa_alloc(&session->games, &handle, game,
+	                   XA_LIMIT(1, READ_ONCE(session_max_games)), GFP_KERNEL_ACCOUNT);
+	if(err) {
+		put_game(game);
+		// every handle up to the limit is taken
+		return err == -EBUSY ? -ENOSPC : err;
+	}
+
+	if(put_user(handle, arg)) {
+		if(xa_erase(&session->games, handle) == game)
+			put_game(game);
+
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static long ioctl_game_destroy(struct hangman_session* session, __u32 __user* arg)
+{
+	u32 handle;
+	if(get_user(handle, arg))
+		return -EFAULT;
+
+	struct hangman_game* game = xa_erase(&session->games, handle);
+	if(!game)
+		return -ENOENT;
+
+	put_game(game);
+	return 0;
+}
+
+// draw a new secret from the word bank for the game, the bank is not reset
+static long ioctl_game_restart(struct hangman_session* session, __u32 __user* arg)
+{
+	u32 handle;
+	if(get_user(handle, arg))
+		return -EFAULT;
+
+	struct hangman_game* game = get_handle_game(session, handle);
+	if(!game)
+		return -ENOENT;
+
+	long ret = 0;
+	if(mutex_lock_interruptible(&game->lock)) {
+		ret = -EINTR;
+		goto out;
+	}
+
+	restart_game(session->dev, game);
+	mutex_unlock(&game->lock);
+	prepare_game(session->dev, game);
+out:
+	put_game(game);
+	return ret;
+}
+
+static long ioctl_game_guess(struct hangman_session* session, struct hangman_game_guess __user* arg)
+{
+	struct hangman_game_guess guess;
+	if(copy_from_user(&guess, arg, sizeof(guess)))
+		return -EFAULT;
+
+	char letter = normalize_guess(guess.letter);
+	if(!letter)
+		return -EINVAL;
+
+	struct hangman_game* game = get_handle_game(session, guess.handle);
+	if(!game)
+		return -ENOENT;
+
+	long ret = 0;
+	if(mutex_lock_interruptible(&game->lock)) {
+		ret = -EINTR;
+		goto out;
+	}
+
+	// like the letters of a write after the game ended
+	if(game->status != HANGMAN_STATUS_PLAYING)
+		guess.result = HANGMAN_GUESS_SKIPPED;
+	else
+		guess.result = apply_guess(game, letter);
+
+	guess.status = game->status;
+	guess.num_guesses = game->num_guesses;
+	mutex_unlock(&game->lock);
+
+	if(copy_to_user(arg, &guess, sizeof(guess)))
+		ret = -EFAULT;
+out:
+	put_game(game);
+	return ret;
+}
+
+static long ioctl_game_state(struct hangman_session* session, struct hangman_game_state __user* arg)
+{
+	struct hangman_game_state req;
+	if(get_user(req.handle, &arg->handle))
+		return -EFAULT;
+
+	struct hangman_game* game = get_handle_game(session, req.handle);
+	if(!game)
+		return -ENOENT;
+
+	long ret = 0;
+	if(mutex_lock_interruptible(&game->lock)) {
+		ret = -EINTR;
+		goto out;
+	}
+
+	fill_state(game, &req.state);
+	mutex_unlock(&game->lock);
+
+	req.reserved = 0;
+	if(copy_to_user(arg, &req, sizeof(req)))
+		ret = -EFAULT;
+out:
+	put_game(game);
+	return ret;
+}
+
+// restrict the session's game to bank words in a length and difficulty
+// range, starting a new round with such a word
+static long ioctl_set_filter(struct hangman_session* session, const struct hangman_word_filter __user* arg)
+{
+	struct hangman_game* game = session->game;
+	struct hangman_word_filter filter;
+	if(copy_from_user(&filter, arg, sizeof(filter)))
+		return -EFAULT;
+
+	if(mutex_lock_interruptible(&game->lock))
+		return -EINTR;
+
+	long ret = 0;
+	rcu_read_lock();
+	struct word_bank* bank = rcu_dereference(session->dev->word_bank);
+
+	if(bank_count(bank, &filter) == 0) {
+		ret = -ENOENT;
+	} else {
+		game->filter = filter;
+		new_round(game, bank);
+	}
+
+	rcu_read_unlock();
+	mutex_unlock(&game->lock);
+
+	if(!ret)
+		prepare_game(session->dev, game);
+
+	return ret;
+}
+
+// suggest a next guess from the bank words the game could still be
+static long ioctl_hint(struct hangman_session* session, struct hangman_hint __user* arg)
+{
+	struct hangman_game* game = session->game;
+	struct hangman_view view;
+	struct hangman_hint hint;
+
+	if(mutex_lock_interruptible(&game->lock))
+		return -EINTR;
+
+	game_view(game, &view);
+	mutex_unlock(&game->lock);
+
+	// the scan only needs the snapshot, not the game lock
+	rcu_read_lock();
+	bank_hint(rcu_dereference(session->dev->word_bank), &view, &hint);
+	rcu_read_unlock();
+
+	if(copy_to_user(arg, &hint, sizeof(hint)))
+		return -EFAULT;
+
+	return 0;
+}
+
+// lock the game and record it in snap
+static int save_game(struct hangman_game* game, u32 handle, struct hangman_snapshot_game* snap)
+{
+	if(mutex_lock_interruptible(&game->lock))
+		return -EINTR;
+
+	game_save(game, handle, snap);
+	mutex_unlock(&game->lock);
+	return 0;
+}
+
+// write the device's word bank and every game of the session to userspace in
+// the layout described by struct hangman_snapshot_header
+static long ioctl_snapshot_save(struct hangman_session* session, struct hangman_snapshot_buf __user* arg)
+{
+	struct hangman_snapshot_buf req;
+	if(copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	struct hangman_game* game;
+	unsigned long handle;
+	u32 count = 1;
+
+	// games created after the count are left out, as if created after the save
+	xa_for_each(&session->games, handle, game)
+		count++;
+
+	struct hangman_snapshot_game* games = kvcalloc(count, sizeof(*games), GFP_KERNEL);
+	if(!games)
+		return -ENOMEM;
+
+	long ret = save_game(session->game, 0, &games[0]);
+	if(ret)
+		goto out_free;
+
+	u32 saved = 1;
+	xa_for_each(&session->games, handle, game) {
+		if(saved == count)
+			break;
+
+		// the game may be destroyed meanwhile
+		game = get_handle_game(session, handle);
+		if(!game)
+			continue;
+
+		ret = save_game(game, handle, &games[saved]);
+		put_game(game);
+		if(ret)
+			goto out_free;
+
+		saved++;
+	}
+
+	struct word_bank* bank = get_word_bank(session->dev);
+	struct hangman_snapshot_header header = {
+		.magic = HANGMAN_SNAPSHOT_MAGIC,
+		.version = HANGMAN_SNAPSHOT_VERSION,
+		.bank_len = bank_text_len(bank),
+		.game_count = saved,
+	};
+
+	size_t bank_size = ALIGN(header.bank_len, 8);
+	size_t games_size = saved * sizeof(*games);
+	size_t size = sizeof(header) + bank_size + games_size;
+
+	if(size > U32_MAX) {
+		ret = -E2BIG;
+		goto out_put;
+	}
+
+	header.size = size;
+	if(req.len < size) {
+		ret = -ENOSPC;
+		goto out_len;
+	}
+
+	char __user* data = u64_to_user_ptr(req.data);
+	if(copy_to_user(data, &header, sizeof(header)) ||
+	   copy_to_user(data + sizeof(header), bank->arena, header.bank_len) ||
+	   clear_user(data + sizeof(header) + header.bank_len, bank_size - header.bank_len) ||
+	   copy_to_user(data + sizeof(header) + bank_size, games, games_size)) {
+		ret = -EFAULT;
+		goto out_put;
+	}
+
+out_len:
+	req.len = size;
+	if(copy_to_user(arg, &req, sizeof(req)))
+		ret = -EFAULT;
+out_put:
+	put_word_bank(bank);
+out_free:
+	kvfree(games);
+	return ret;
+}
+
+// parse a snapshot's words into a new bank, which nobody can see yet
+static struct word_bank* load_snapshot_bank(const char* words, u32 len)
+{
+	struct bank_load load;
+
+	int err = bank_load_init(&load);
+	if(err)
+		return ERR_PTR(err);
+
+	err = bank_load_feed(&load, words, len);
+	if(err) {
+		bank_load_abort(&load);
+		return ERR_PTR(err);
+	}
+
+	return bank_load_finish(&load);
+}
+
+// restore a snapshot made by ioctl_snapshot_save(). Everything is checked and
+// built first, so a snapshot that cannot be loaded leaves the device and the
+// session as they were
+static long ioctl_snapshot_load(struct hangman_session* session, const struct hangman_snapshot_buf __user* arg)
+{
+	struct hangman_snapshot_buf req;
+	if(copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	const struct hangman_snapshot_header* header;
+	if(req.len < sizeof(*header))
+		return -EINVAL;
+
+	// no snapshot within the bank and game limits is larger, and kvmalloc()
+	// warns about anything past INT_MAX
+	size_t max_size = sizeof(*header) + ALIGN((size_t)READ_ONCE(bank_max_bytes), 8) +
+	                  ((size_t)READ_ONCE(session_max_games) + 1) * sizeof(struct hangman_snapshot_game);
+	if(req.len > min_t(size_t, max_size, INT_MAX))
+		return -E2BIG;
+
+	// one bulk copy of the whole snapshot
+	char* buf = kvmalloc(req.len, GFP_KERNEL_ACCOUNT | __GFP_NOWARN);
+	if(!buf)
+		return -ENOMEM;
+
+	struct word_bank* bank = NULL;
+	struct hangman_game** restored = NULL;
+	const struct hangman_snapshot_game* games;
+	u32 inserted = 0;
+	long ret = 0;
+
+	if(copy_from_user(buf, u64_to_user_ptr(req.data), req.len)) {
+		ret = -EFAULT;
+		goto out_free;
+	}
+
+	header = (const struct hangman_snapshot_header*)buf;
+	size_t bank_size = ALIGN((size_t)header->bank_len, 8);
+	size_t size = sizeof(*header) + bank_size + (size_t)header->game_count * sizeof(*games);
+
+	if(header->magic != HANGMAN_SNAPSHOT_MAGIC || header->size != req.len || size != req.len) {
+		ret = -EINVAL;
+		goto out_free;
+	}
+
+	if(header->version != HANGMAN_SNAPSHOT_VERSION) {
+		ret = -EOPNOTSUPP;
+		goto out_free;
+	}
+
+	// the handle games are subject to the same limit as GAME_CREATE, checked
+	// before any of them is allocated
+	u32 max_games = READ_ONCE(session_max_games);
+	if(header->game_count > max_games + 1) {
+		ret = -ENOSPC;
+		goto out_free;
+	}
+
+	// at most one record may be the read/write game
+	bool session_game = false;
+	games = (const struct hangman_snapshot_game*)(buf + sizeof(*header) + bank_size);
+	for(u32 i = 0; i < header->game_count; i++) {
+		if(!snapshot_game_valid(&games[i]) || (!games[i].handle && session_game)) {
+			ret = -EINVAL;
+			goto out_free;
+		}
+
+		if(games[i].handle > max_games) {
+			ret = -ENOSPC;
+			goto out_free;
+		}
+
+		session_game |= !games[i].handle;
+	}
+
+	if(header->bank_len) {
+		bank = load_snapshot_bank(buf + sizeof(*header), header->bank_len);
+		if(IS_ERR(bank)) {
+			ret = PTR_ERR(bank);
+			bank = NULL;
+			goto out_free;
+		}
+	}
+
+	restored = kvcalloc(header->game_count, sizeof(*restored), GFP_KERNEL);
+	if(header->game_count && !restored) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	// the handle games are created and filled in before any is inserted
+	for(u32 i = 0; i < header->game_count; i++) {
+		if(!games[i].handle)
+			continue;
+
+		restored[i] = alloc_game(session->dev);
+		if(!restored[i]) {
+			ret = -ENOMEM;
+			goto out_put;
+		}
+
+		mutex_lock(&restored[i]->lock);
+		game_restore(restored[i], &games[i]);
+		mutex_unlock(&restored[i]->lock);
+	}
+
+	for(; inserted < header->game_count; inserted++) {
+		if(!restored[inserted])
+			continue;
+
+		ret = xa_insert(&session->games, games[inserted].handle, restored[inserted], GFP_KERNEL_ACCOUNT);
+		if(ret)
+			goto out_erase;
+	}
+
+	if(bank) {
+		publish_word_bank(session->dev, bank);
+		bank = NULL;
+	}
+
+	for(u32 i = 0; i < header->game_count; i++) {
+		if(games[i].handle)
+			continue;
+
+		mutex_lock(&session->game->lock);
+		game_restore(session->game, &games[i]);
+		mutex_unlock(&session->game->lock);
+	}
+
+	// the table holds the references of the handle games now
+	goto out_free;
+
+out_erase:
+	while(inserted--) {
+		if(restored[inserted])
+			xa_erase(&session->games, games[inserted].handle);
+	}
+out_put:
+	for(u32 i = 0; i < header->game_count; i++) {
+		if(restored[i])
+			put_game(restored[i]);
+	}
+out_free:
+	kvfree(restored);
+	if(bank)
+		free_word_bank(bank);
+	kvfree(buf);
+	return ret;
+}
+
+static long do_ioctl(struct file* file, unsigned int cmd, unsigned long arg)
+{
+	struct hangman_session* session = file->private_data;
+	struct hangman_game* game = session->game;
+
+	switch(cmd)
+	{
+	case HANGMAN_IOC_READ_BANK:
+		return ioctl_read_word_bank(session->dev, (void* __user)arg);
+	case HANGMAN_IOC_READ_SECRET:
+		return ioctl_read_secret_word(game, (void* __user)arg);
+	case HANGMAN_IOC_WRITE_BANK:
+		return ioctl_write_word_bank(session->dev, (void* __user)arg);
+	case HANGMAN_IOC_WRITE_SECRET:
+		return ioctl_write_secret_word(game, (void* __user)arg);
+	case HANGMAN_IOC_RESTART:
+		return ioctl_restart(file);
+	case HANGMAN_IOC_SET_BATCH:
+		return ioctl_set_batch(game, (int* __user)arg);
+	case HANGMAN_IOC_BATCH_RESULT:
+		return ioctl_batch_result(game, (void* __user)arg);
+	case HANGMAN_IOC_GET_STATE:
+		return ioctl_get_state(game, (void* __user)arg);
+	case HANGMAN_IOC_GAME_CREATE:
+		return ioctl_game_create(session, (__u32* __user)arg);
+	case HANGMAN_IOC_GAME_DESTROY:
+		return ioctl_game_destroy(session, (__u32* __user)arg);
+	case HANGMAN_IOC_GAME_RESTART:
+		return ioctl_game_restart(session, (__u32* __user)arg);
+	case HANGMAN_IOC_GAME_GUESS:
+		return ioctl_game_guess(session, (void* __user)arg);
+	case HANGMAN_IOC_GAME_STATE:
+		return ioctl_game_state(session, (void* __user)arg);
+	case HANGMAN_IOC_BANK_BEGIN:
+		return ioctl_bank_begin(session);
+	case HANGMAN_IOC_BANK_APPEND:
+		return ioctl_bank_append(session, (void* __user)arg);
+	case HANGMAN_IOC_BANK_COMMIT:
+		return ioctl_bank_commit(session);
+	case HANGMAN_IOC_BANK_ABORT:
+		return ioctl_bank_abort(session);
+	case HANGMAN_IOC_SET_FILTER:
+		return ioctl_set_filter(session, (void* __user)arg);
+	case HANGMAN_IOC_HINT:
+		return ioctl_hint(session, (void* __user)arg);
+	case HANGMAN_IOC_BANK_READ:
+		return ioctl_bank_read(session->dev, (void* __user)arg);
+	case HANGMAN_IOC_SNAPSHOT_SAVE:
+		return ioctl_snapshot_save(session, (void* __user)arg);
+	case HANGMAN_IOC_SNAPSHOT_LOAD:
+		return ioctl_snapshot_load(session, (void* __user)arg);
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static long hangman_ioctl(struct file* file, unsigned int cmd, unsigned long arg)
+{
+	long ret = do_ioctl(file, cmd, arg);
+	trace_hangman_ioctl(file_game(file), cmd, ret);
+	return ret;
+}
+
+static loff_t seek_game(struct file* file, loff_t off, int whence)
+{
+	char buf[OUTPUT_SIZE];
+	size_t len = render_game(file_game(file), buf, NULL);
+	loff_t pos;
+
+	switch(whence)
+	{
+	case SEEK_SET:
+		pos = off;
+		break;
+	case SEEK_CUR:
+		pos = file->f_pos + off;
+		break;
+	case SEEK_END:
+		pos = len + off;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if(pos < 0)
+		pos = 0;
+	else if(pos >= len)
+		pos = len - 1;
+
+	file->f_pos = pos;
+	return pos;
+}
+
+static loff_t hangman_llseek(struct file* file, loff_t off, int whence)
+{
+	loff_t ret = seek_game(file, off, whence);
+	trace_hangman_llseek(file_game(file), off, whence, ret);
+	return ret;
+}
+
+// the game is readable once it has changed since it was last read with
+// read() or HANGMAN_IOC_GET_STATE, guesses never block
+static __poll_t hangman_poll(struct file* file, poll_table* wait)
+{
+	struct hangman_game* game = file_game(file);
+	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
+
+	poll_wait(file, &game->wait, wait);
+
+	if(READ_ONCE(game->gen) != READ_ONCE(game->read_gen))
+		mask |= EPOLLIN | EPOLLRDNORM;
+
+	return mask;
+}
+
+// map a read-only page holding a struct hangman_shared_state that follows
+// the game without any further syscalls
+static int hangman_mmap(struct file* file, struct vm_area_struct* vma)
+{
+	struct hangman_game* game = file_game(file);
+
+	if(vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > PAGE_SIZE)
+		return -EINVAL;
+
+	if(vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if(mutex_lock_interruptible(&game->lock))
+		return -EINTR;
+
+	if(!game->shared) {
+		// vmalloc_user() hands back a zeroed page that may be mapped to userspace
+		game->shared = vmalloc_user(PAGE_SIZE);
+		if(!game->shared) {
+			mutex_unlock(&game->lock);
+			return -ENOMEM;
+		}
+
+		publish_shared_state(game);
+	}
+
+	mutex_unlock(&game->lock);
+
+	vm_flags_clear(vma, VM_MAYWRITE);
+	return remap_vmalloc_range(vma, game->shared, 0);
+}
+
+static struct file_operations hangman_fops = {
+	.owner = THIS_MODULE,
+	.open = hangman_open,
+	.release = hangman_release,
+	.read_iter = hangman_read_iter,
+	.write_iter = hangman_write_iter,
+	.unlocked_ioctl = hangman_ioctl,
+	.llseek = hangman_llseek,
+	.mmap = hangman_mmap,
+	.poll = hangman_poll,
+};
+
+static int stats_show(struct seq_file* m, void* v)
+{
+	for(int i = 0; i < NR_STATS; i++) {
+		u64 sum = 0;
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			sum += per_cpu(hangman_stats, cpu).count[i];
+
+		seq_printf(m, "%s %llu\n", stat_names[i], sum);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(stats);
+
+// give dev its own default bank and register its node
+static int init_device(struct hangman_device* dev, unsigned int idx)
+{
+	struct word_bank* bank = alloc_default_bank();
+	if(!bank)
+		return -ENOMEM;
+
+	kref_init(&bank->ref);
+	RCU_INIT_POINTER(dev->word_bank, bank);
+	mutex_init(&dev->word_bank_lock);
+
+	// a single node keeps the name clients have always opened
+	if(num_devices == 1)
+		strscpy(dev->name, "hangman", sizeof(dev->name));
+	else
+		snprintf(dev->name, sizeof(dev->name), "hangman%u", idx);
+
+	dev->md.minor = MISC_DYNAMIC_MINOR;
+	dev->md.name = dev->name;
+	dev->md.fops = &hangman_fops;
+	dev->md.mode = 0666;
+
+	int ret = misc_register(&dev->md);
+	if(ret) {
+		mutex_destroy(&dev->word_bank_lock);
+		free_word_bank(bank);
+	}
+
+	return ret;
+}
+
+// undo init_device() on the first count devices
+static void destroy_devices(unsigned int count)
+{
+	for(unsigned int i = 0; i < count; i++)
+		misc_deregister(&devices[i].md);
+
+	// no sessions remain, but replaced banks and released games may still be
+	// waiting in call_rcu
+	rcu_barrier();
+
+	for(unsigned int i = 0; i < count; i++) {
+		free_word_bank(rcu_dereference_protected(devices[i].word_bank, 1));
+		mutex_destroy(&devices[i].word_bank_lock);
+	}
+}
+
+static int __init hangman_init(void)
+{
+	unsigned int i;
+	int ret = -ENOMEM;
+
+	if(num_devices == 0 || num_devices > MAX_DEVICES)
+		return -EINVAL;
+
+	// games are created on behalf of users, so they count against their memcg
+	game_cache = KMEM_CACHE(hangman_game, SLAB_HWCACHE_ALIGN | SLAB_ACCOUNT);
+	if(!game_cache)
+		goto fail_cache;
+
+	devices = kcalloc(num_devices, sizeof(*devices), GFP_KERNEL);
+	if(!devices)
+		goto fail_devices;
+
+	for(i = 0; i < num_devices; i++) {
+		ret = init_device(&devices[i], i);
+		if(ret)
+			goto fail_register;
+	}
+
+	// statistics are optional, debugfs failures are not fatal
+	hangman_debugfs = debugfs_create_dir("hangman", NULL);
+	debugfs_create_file("stats", 0444, hangman_debugfs, NULL, &stats_fops);
+
+	return 0;
+
+fail_register:
+	destroy_devices(i);
+	kfree(devices);
+fail_devices:
+	kmem_cache_destroy(game_cache);
+fail_cache:
+	return ret;
+}
+
+static void __exit hangman_exit(void)
+{
+	debugfs_remove_recursive(hangman_debugfs);
+	destroy_devices(num_devices);
+	kfree(devices);
+	kmem_cache_destroy(game_cache);
+}
+
+module_init(hangman_init);
+module_exit(hangman_exit);
@@ -0,0 +1,258 @@
+#ifndef HANGMAN_SHIM_H
+#define HANGMAN_SHIM_H
+// Userspace stand-ins for the kernel APIs used by hangman_core.c, so the game
+// engine can be built into an ordinary program. Only what the core needs is
+// here: allocation, mutexes, user copies (plain memcpy, there is only one
+// address space) and a fast per-thread random number generator
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <pthread.h>
+#include <linux/types.h>
+
+typedef __u8 u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef __u64 u64;
+
+#define __user
+#define GFP_KERNEL 0
+#define GFP_KERNEL_ACCOUNT 0
+#define U32_MAX UINT32_MAX
+
+#define BIT(nr) (1UL << (nr))
+#define BIT_ULL(nr) (1ULL << (nr))
+#define GENMASK_ULL(h, l) ((~0ULL << (l)) & (~0ULL >> (63 - (h))))
+#define hweight32(w) __builtin_popcount(w)
+
+#define min_t(type, x, y) ((type)(x) < (type)(y) ? (type)(x) : (type)(y))
+#define max_t(type, x, y) ((type)(x) > (type)(y) ? (type)(x) : (type)(y))
+#define check_add_overflow(a, b, d) __builtin_add_overflow(a, b, d)
+
+#define READ_ONCE(x) (*(const volatile __typeof__(x)*)&(x))
+#define WRITE_ONCE(x, val) (*(volatile __typeof__(x)*)&(x) = (val))
+
+#define SMP_CACHE_BYTES 64
+#define ____cacheline_aligned __attribute__((aligned(SMP_CACHE_BYTES)))
+
+#define container_of(ptr, type, member) ((type*)((char*)(ptr) - offsetof(type, member)))
+
+// the kernel's ctype takes a char, ASCII is all the core relies on
+static inline int shim_isalpha(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static inline char shim_toupper(char c)
+{
+	return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+#define isalpha(c) shim_isalpha(c)
+#define toupper(c) shim_toupper(c)
+
+static inline int scnprintf(char* buf, size_t size, const char* fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	int n = vsnprintf(buf, size, fmt, args);
+	va_end(args);
+
+	if(n < 0 || size == 0)
+		return 0;
+
+	return (size_t)n >= size ? (int)size - 1 : n;
+}
+
+// allocation
+
+// cache line aligned, so ____cacheline_aligned structs can live here
+static inline void* kzalloc(size_t size, int flags)
+{
+	void* p;
+
+	(void)flags;
+	if(posix_memalign(&p, SMP_CACHE_BYTES, size))
+		return NULL;
+
+	return memset(p, 0, size);
+}
+
+static inline void kfree(const void* p)
+{
+	free((void*)p);
+}
+
+static inline void* kvmalloc(size_t size, int flags)
+{
+	(void)flags;
+	return malloc(size);
+}
+
+static inline void* kvmalloc_array(size_t n, size_t size, int flags)
+{
+	size_t bytes;
+	if(__builtin_mul_overflow(n, size, &bytes))
+		return NULL;
+
+	return kvmalloc(bytes, flags);
+}
+
+static inline void* kvcalloc(size_t n, size_t size, int flags)
+{
+	(void)flags;
+	return calloc(n, size);
+}
+
+static inline void kvfree(const void* p)
+{
+	free((void*)p);
+}
+
+#define ERR_PTR(err) ((void*)(long)(err))
+#define PTR_ERR(p) ((long)(p))
+#define IS_ERR(p) ((unsigned long)(p) >= (unsigned long)-4095)
+
+// locking
+
+struct mutex {
+	pthread_mutex_t m;
+};
+
+static inline void mutex_init(struct mutex* lock)
+{
+	pthread_mutex_init(&lock->m, NULL);
+}
+
+static inline void mutex_destroy(struct mutex* lock)
+{
+	pthread_mutex_destroy(&lock->m);
+}
+
+static inline void mutex_lock(struct mutex* lock)
+{
+	pthread_mutex_lock(&lock->m);
+}
+
+// a userspace lock cannot be interrupted by a signal, this never fails
+static inline int mutex_lock_interruptible(struct mutex* lock)
+{
+	pthread_mutex_lock(&lock->m);
+	return 0;
+}
+
+static inline int mutex_trylock(struct mutex* lock)
+{
+	return pthread_mutex_trylock(&lock->m) == 0;
+}
+
+static inline void mutex_unlock(struct mutex* lock)
+{
+	pthread_mutex_unlock(&lock->m);
+}
+
+// spinlocks only guard a few hundred bytes of work, a mutex is fine here
+typedef struct {
+	pthread_mutex_t m;
+} spinlock_t;
+
+static inline void spin_lock_init(spinlock_t* lock)
+{
+	pthread_mutex_init(&lock->m, NULL);
+}
+
+static inline void spin_lock(spinlock_t* lock)
+{
+	pthread_mutex_lock(&lock->m);
+}
+
+static inline void spin_unlock(spinlock_t* lock)
+{
+	pthread_mutex_unlock(&lock->m);
+}
+
+// only there so struct hangman_game and struct word_bank compile, the core
+// never uses them. The layout differs from the module's anyway, the locks
+// above are pthread mutexes
+struct rcu_head {
+	struct rcu_head* next;
+	void (*func)(struct rcu_head* head);
+};
+
+struct kref {
+	int refcount;
+};
+
+typedef struct {
+	int unused;
+} wait_queue_head_t;
+
+typedef struct {
+	unsigned int sequence;
+} seqcount_t;
+
+typedef struct {
+	long long counter;
+} atomic64_t;
+
+#define ATOMIC64_INIT(i) { (i) }
+
+static inline long long atomic64_inc_return(atomic64_t* v)
+{
+	return __atomic_add_fetch(&v->counter, 1, __ATOMIC_RELAXED);
+}
+
+// user copies, returning the number of bytes not copied like the kernel
+
+static inline unsigned long copy_to_user(void __user* to, const void* from, unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+static inline unsigned long copy_from_user(void* to, const void __user* from, unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+#define get_user(x, ptr) ({ (x) = *(ptr); 0; })
+#define put_user(x, ptr) ({ *(ptr) = (x); 0; })
+
+// randomness, xorshift64* seeded per thread
+
+static inline u32 get_random_u32(void)
+{
+	static __thread u64 state;
+
+	if(!state)
+		state = ((u64)(uintptr_t)&state << 16) ^ 0x9e3779b97f4a7c15ull;
+
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return (state * 2685821657736338717ull) >> 32;
+}
+
+// unbiased like the kernel version, by rejecting the short last interval
+static inline u32 get_random_u32_below(u32 ceil)
+{
+	u64 mult = (u64)get_random_u32() * ceil;
+
+	if((u32)mult < ceil) {
+		u32 bound = -ceil % ceil;
+		while((u32)mult < bound)
+			mult = (u64)get_random_u32() * ceil;
+	}
+
+	return mult >> 32;
+}
+
+#endif
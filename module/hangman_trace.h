@@ -0,0 +1,132 @@
+// Tracepoints for the hangman driver, under events/hangman/ in tracefs
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM hangman
+
+#if !defined(HANGMAN_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define HANGMAN_TRACE_H
+
+#include <linux/tracepoint.h>
+
+// read/write: bytes is the number of bytes asked for, ret what was returned
+DECLARE_EVENT_CLASS(hangman_rw,
+	TP_PROTO(const void* game, loff_t pos, size_t bytes, ssize_t ret),
+	TP_ARGS(game, pos, bytes, ret),
+
+	TP_STRUCT__entry(
+		__field(const void*, game)
+		__field(loff_t, pos)
+		__field(size_t, bytes)
+		__field(ssize_t, ret)
+	),
+
+	TP_fast_assign(
+		__entry->game = game;
+		__entry->pos = pos;
+		__entry->bytes = bytes;
+		__entry->ret = ret;
+	),
+
+	TP_printk("game=%p pos=%lld bytes=%zu ret=%zd",
+		__entry->game, __entry->pos, __entry->bytes, __entry->ret)
+);
+
+DEFINE_EVENT(hangman_rw, hangman_read,
+	TP_PROTO(const void* game, loff_t pos, size_t bytes, ssize_t ret),
+	TP_ARGS(game, pos, bytes, ret)
+);
+
+DEFINE_EVENT(hangman_rw, hangman_write,
+	TP_PROTO(const void* game, loff_t pos, size_t bytes, ssize_t ret),
+	TP_ARGS(game, pos, bytes, ret)
+);
+
+TRACE_EVENT(hangman_ioctl,
+	TP_PROTO(const void* game, unsigned int cmd, long ret),
+	TP_ARGS(game, cmd, ret),
+
+	TP_STRUCT__entry(
+		__field(const void*, game)
+		__field(unsigned int, cmd)
+		__field(long, ret)
+	),
+
+	TP_fast_assign(
+		__entry->game = game;
+		__entry->cmd = cmd;
+		__entry->ret = ret;
+	),
+
+	TP_printk("game=%p cmd=0x%x nr=%u ret=%ld",
+		__entry->game, __entry->cmd, _IOC_NR(__entry->cmd), __entry->ret)
+);
+
+TRACE_EVENT(hangman_llseek,
+	TP_PROTO(const void* game, loff_t off, int whence, loff_t ret),
+	TP_ARGS(game, off, whence, ret),
+
+	TP_STRUCT__entry(
+		__field(const void*, game)
+		__field(loff_t, off)
+		__field(int, whence)
+		__field(loff_t, ret)
+	),
+
+	TP_fast_assign(
+		__entry->game = game;
+		__entry->off = off;
+		__entry->whence = whence;
+		__entry->ret = ret;
+	),
+
+	TP_printk("game=%p off=%lld whence=%d ret=%lld",
+		__entry->game, __entry->off, __entry->whence, __entry->ret)
+);
+
+TRACE_EVENT(hangman_init_game,
+	TP_PROTO(const void* game, u8 secret_len, u64 bank_gen),
+	TP_ARGS(game, secret_len, bank_gen),
+
+	TP_STRUCT__entry(
+		__field(const void*, game)
+		__field(u8, secret_len)
+		__field(u64, bank_gen)
+	),
+
+	TP_fast_assign(
+		__entry->game = game;
+		__entry->secret_len = secret_len;
+		__entry->bank_gen = bank_gen;
+	),
+
+	TP_printk("game=%p secret_len=%u bank_gen=%llu",
+		__entry->game, __entry->secret_len, __entry->bank_gen)
+);
+
+TRACE_EVENT(hangman_write_bank,
+	TP_PROTO(size_t bytes, u32 word_count, long ret),
+	TP_ARGS(bytes, word_count, ret),
+
+	TP_STRUCT__entry(
+		__field(size_t, bytes)
+		__field(u32, word_count)
+		__field(long, ret)
+	),
+
+	TP_fast_assign(
+		__entry->bytes = bytes;
+		__entry->word_count = word_count;
+		__entry->ret = ret;
+	),
+
+	TP_printk("bytes=%zu word_count=%u ret=%ld",
+		__entry->bytes, __entry->word_count, __entry->ret)
+);
+
+#endif
+
+// the header lives next to hangman_main.c rather than in include/trace/events
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE hangman_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,219 @@
+#ifndef HANGMAN_UAPI_H
+#define HANGMAN_UAPI_H
+// Interface shared by the hangman module and its userspace clients
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define MAX_BANK_SIZE 500
+#define MAX_SECRET_SIZE 50
+#define HANGMAN_MAX_WORD_LEN 63
+#define HANGMAN_MAX_BATCH 64
+#define HANGMAN_NUM_LETTERS 26
+
+// Outcome of each guess of the last write, see HANGMAN_IOC_BATCH_RESULT
+#define HANGMAN_GUESS_HIT	1	// letter is in the secret
+#define HANGMAN_GUESS_MISS	2	// letter is not in the secret
+#define HANGMAN_GUESS_REPEAT	3	// letter was already guessed
+#define HANGMAN_GUESS_SKIPPED	4	// game ended before this letter
+
+// Values of hangman_state.status
+#define HANGMAN_STATUS_PLAYING	0
+#define HANGMAN_STATUS_LOST	1
+#define HANGMAN_STATUS_WON	2
+
+struct hangman_batch_result {
+	__u32 count;
+	__u8 results[HANGMAN_MAX_BATCH];
+};
+
+// Fixed layout snapshot of a game, returned by HANGMAN_IOC_GET_STATE
+struct hangman_state {
+	__u64 gen;			// changes whenever the game changes
+	__u64 revealed_pos;		// bit i is set when letter i of the secret is shown
+	__u32 guessed_mask;		// bit n is set once 'A' + n was guessed
+	__u8 secret_len;
+	__u8 num_guesses;		// guesses left
+	__u8 status;			// HANGMAN_STATUS_*
+	__u8 bad_count;
+	char reveal[HANGMAN_MAX_WORD_LEN + 1];	// '-' for hidden letters, '\0' terminated
+	char bad_guesses[HANGMAN_NUM_LETTERS];	// wrong letters in the order guessed
+	__u8 reserved[6];
+};
+
+// Argument of HANGMAN_IOC_GAME_GUESS. The caller fills in handle and letter,
+// the driver fills in the rest. A guess on a game that is already won or lost
+// changes nothing and has result HANGMAN_GUESS_SKIPPED
+struct hangman_game_guess {
+	__u32 handle;
+	char letter;
+	__u8 result;			// HANGMAN_GUESS_*
+	__u8 status;			// HANGMAN_STATUS_* after the guess
+	__u8 num_guesses;		// guesses left after the guess
+};
+
+// Argument of HANGMAN_IOC_GAME_STATE. The caller fills in handle
+struct hangman_game_state {
+	__u32 handle;
+	__u32 reserved;
+	struct hangman_state state;
+};
+
+// Argument of HANGMAN_IOC_BANK_APPEND: len bytes of words separated by ','
+// or '\n' at the user address data. A word may be split across chunks
+struct hangman_bank_chunk {
+	__u64 data;
+	__u32 len;
+	__u32 reserved;
+};
+
+// Argument of HANGMAN_IOC_SET_FILTER. A word's difficulty is the number of
+// distinct letters in it. A max of 0 means no upper limit, an all zero
+// filter matches every word
+struct hangman_word_filter {
+	__u8 min_len;
+	__u8 max_len;
+	__u8 min_difficulty;
+	__u8 max_difficulty;
+};
+
+// Result of HANGMAN_IOC_HINT. candidates is the number of bank words that
+// fit what the player can see: the revealed letters and the wrong guesses.
+// letter is the unguessed letter found in the most of them, or 0 if there
+// are no candidates or none of them has an unguessed letter
+struct hangman_hint {
+	__u32 candidates;
+	char letter;
+	__u8 reserved[3];
+};
+
+// Argument of HANGMAN_IOC_BANK_READ, which copies part of the word bank as
+// words joined by ','. The caller fills in data, len, offset, flags and gen,
+// the driver sets len to the bytes copied, total to the size of the whole
+// bank and gen to the bank's generation. Generations are never 0 and never
+// reused, so a client can cache the bank under its generation:
+//
+// - with HANGMAN_BANK_READ_IF_CHANGED, nothing is copied if the bank is
+//   still gen, the driver leaves gen unchanged
+// - otherwise a non-zero gen must be the current bank, or the call fails with
+//   ESTALE, so the pages of one listing all come from the same bank
+#define HANGMAN_BANK_READ_IF_CHANGED	1
+
+struct hangman_bank_read {
+	__u64 data;			// user address of the buffer
+	__u64 gen;
+	__u32 offset;			// first byte of the bank to copy
+	__u32 len;			// size of the buffer, then bytes copied
+	__u32 total;
+	__u32 flags;			// HANGMAN_BANK_READ_*
+};
+
+// Snapshot of a device's word bank and of the games of one session, saved
+// with HANGMAN_IOC_SNAPSHOT_SAVE and restored with HANGMAN_IOC_SNAPSHOT_LOAD,
+// for instance across a reload of the module. It is laid out as:
+//
+//	struct hangman_snapshot_header
+//	bank_len bytes of words joined by ',', zero padded to 8 bytes
+//	game_count struct hangman_snapshot_game
+//
+// Fields are in the byte order of the machine that saved the snapshot. A
+// change to the layout bumps HANGMAN_SNAPSHOT_VERSION
+#define HANGMAN_SNAPSHOT_MAGIC		0x4d474e48	// "HNGM" on little endian machines
+#define HANGMAN_SNAPSHOT_VERSION	1
+
+struct hangman_snapshot_header {
+	__u32 magic;
+	__u32 version;
+	__u32 size;			// bytes of the whole snapshot
+	__u32 bank_len;
+	__u32 game_count;
+	__u32 reserved;
+};
+
+struct hangman_snapshot_game {
+	__u32 handle;			// 0 for the game played through read/write
+	__u32 guessed_mask;
+	struct hangman_word_filter filter;
+	__u8 secret_len;
+	__u8 num_guesses;
+	__u8 status;
+	__u8 bad_count;
+	__u8 batch;
+	__u8 reserved[3];
+	char secret[HANGMAN_MAX_WORD_LEN + 1];
+	char bad_guesses[HANGMAN_NUM_LETTERS];
+	__u8 reserved2[2];
+};
+
+// Argument of the snapshot ioctls, a buffer of len bytes at the user address
+// data. SNAPSHOT_SAVE sets len to the size of the snapshot, and fails with
+// ENOSPC without copying anything if the buffer is too small for it
+struct hangman_snapshot_buf {
+	__u64 data;
+	__u32 len;
+	__u32 reserved;
+};
+
+// Layout of the read-only page returned by mmap() on /dev/hangman
+//
+// The kernel updates state under a seqcount: seq is odd while an update is
+// in progress. Readers copy state and retry if seq was odd or changed:
+//
+//	do {
+//		seq = load_acquire(&page->seq);
+//		copy = page->state;
+//		read_barrier();
+//	} while((seq & 1) || seq != page->seq);
+struct hangman_shared_state {
+	__u32 seq;
+	__u32 reserved;
+	struct hangman_state state;
+};
+
+// Ioctl command numbers
+#define HANGMAN_MAGIC_NUM   0xff
+#define HANGMAN_IOC_READ_BANK	 _IOR(HANGMAN_MAGIC_NUM, 1, char[MAX_BANK_SIZE])
+#define HANGMAN_IOC_READ_SECRET	 _IOR(HANGMAN_MAGIC_NUM, 2, char[MAX_SECRET_SIZE])
+#define HANGMAN_IOC_WRITE_BANK	 _IOW(HANGMAN_MAGIC_NUM, 3, char[MAX_BANK_SIZE])
+#define HANGMAN_IOC_WRITE_SECRET _IOW(HANGMAN_MAGIC_NUM, 4, char[MAX_SECRET_SIZE])
+#define HANGMAN_IOC_RESTART	 _IO(HANGMAN_MAGIC_NUM, 5)
+#define HANGMAN_IOC_SET_BATCH	 _IOW(HANGMAN_MAGIC_NUM, 6, int)
+#define HANGMAN_IOC_BATCH_RESULT _IOR(HANGMAN_MAGIC_NUM, 7, struct hangman_batch_result)
+#define HANGMAN_IOC_GET_STATE	 _IOR(HANGMAN_MAGIC_NUM, 8, struct hangman_state)
+
+// Extra games on the same file descriptor, addressed by a handle that is
+// never 0. HANGMAN_IOC_RESTART does not touch them. GAME_CREATE fails with
+// ENOSPC once the session has as many games as the module allows
+#define HANGMAN_IOC_GAME_CREATE	 _IOR(HANGMAN_MAGIC_NUM, 9, __u32)
+#define HANGMAN_IOC_GAME_DESTROY _IOW(HANGMAN_MAGIC_NUM, 10, __u32)
+#define HANGMAN_IOC_GAME_RESTART _IOW(HANGMAN_MAGIC_NUM, 11, __u32)
+#define HANGMAN_IOC_GAME_GUESS	 _IOWR(HANGMAN_MAGIC_NUM, 12, struct hangman_game_guess)
+#define HANGMAN_IOC_GAME_STATE	 _IOWR(HANGMAN_MAGIC_NUM, 13, struct hangman_game_state)
+
+// Streaming word bank load, the new bank replaces the old one on commit
+#define HANGMAN_IOC_BANK_BEGIN	 _IO(HANGMAN_MAGIC_NUM, 14)
+#define HANGMAN_IOC_BANK_APPEND	 _IOW(HANGMAN_MAGIC_NUM, 15, struct hangman_bank_chunk)
+#define HANGMAN_IOC_BANK_COMMIT	 _IO(HANGMAN_MAGIC_NUM, 16)
+#define HANGMAN_IOC_BANK_ABORT	 _IO(HANGMAN_MAGIC_NUM, 17)
+
+// Draw this and later secrets of the session's game, and of games created
+// after it by handle, from bank words matching a filter. Fails with ENOENT
+// if no word in the bank matches
+#define HANGMAN_IOC_SET_FILTER	 _IOW(HANGMAN_MAGIC_NUM, 18, struct hangman_word_filter)
+
+// Suggest the next guess for the session's game, see struct hangman_hint
+#define HANGMAN_IOC_HINT	 _IOR(HANGMAN_MAGIC_NUM, 19, struct hangman_hint)
+
+// Read the word bank a page at a time, see struct hangman_bank_read.
+// HANGMAN_IOC_READ_BANK only returns the first MAX_BANK_SIZE bytes
+#define HANGMAN_IOC_BANK_READ	 _IOWR(HANGMAN_MAGIC_NUM, 20, struct hangman_bank_read)
+
+// Save the word bank of the device and every game of the session, or restore
+// them. Loading replaces the bank unless the snapshot has none, restores the
+// read/write game in place and recreates the other games under their saved
+// handles, failing with EBUSY if one of those is already in use and ENOSPC
+// if one is above the GAME_CREATE limit
+#define HANGMAN_IOC_SNAPSHOT_SAVE _IOWR(HANGMAN_MAGIC_NUM, 21, struct hangman_snapshot_buf)
+#define HANGMAN_IOC_SNAPSHOT_LOAD _IOW(HANGMAN_MAGIC_NUM, 22, struct hangman_snapshot_buf)
+
+#endif
@@ -0,0 +1,515 @@
+// Hangman solver for /dev/hangman, used as a load generator and to measure
+// how hard a word bank is
+//
+// The dictionary is the driver's word bank (or a word list that is first
+// loaded into the driver with -f). Candidate words are kept as a bitset, and
+// the dictionary is indexed by bit-sliced bitsets: one set per letter of the
+// words containing it, and one per (letter, position) of the words with that
+// letter at that position. Filtering after a guess and counting how many
+// candidates contain each letter are then AND/ANDNOT and popcount over 64-bit
+// blocks, which the compiler vectorizes.
+//
+// Each thread plays games on its own file descriptor: guesses go through
+// write(), the revealed pattern comes back from HANGMAN_IOC_GET_STATE, and a
+// zeroed HANGMAN_IOC_SET_FILTER starts the next game with a word from the
+// whole bank.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "module/hangman_uapi.h"
+
+#define DEFAULT_PATH "/dev/hangman"
+#define NUM_LETTERS HANGMAN_NUM_LETTERS
+#define MAX_LEN HANGMAN_MAX_WORD_LEN
+#define CHUNK_SIZE 4096
+
+// fallback order when no candidate is left, e.g. the secret isn't a bank word
+static const char letterOrder[] = "ETAOINSHRDLCUMWFGYPBVKJXQZ";
+
+struct dictionary {
+    size_t wordCount;
+    size_t blocks;                  // u64 blocks per bitset
+    uint64_t* byLen[MAX_LEN + 1];   // words of each length
+    uint64_t* hasLetter[NUM_LETTERS];
+    uint64_t* atPos[NUM_LETTERS][MAX_LEN];  // NULL if no word has the letter there
+    uint64_t* empty;                // all zero, stands in for missing atPos sets
+};
+
+struct solver_stats {
+    uint64_t games;
+    uint64_t won;
+    uint64_t guesses;
+    uint64_t misses;
+    uint64_t errors;
+};
+
+struct worker {
+    pthread_t thread;
+    const struct dictionary* dict;
+    const char* path;
+    long games;
+    struct solver_stats stats;
+};
+
+static uint64_t* new_bitset(size_t blocks)
+{
+    return calloc(blocks ? blocks : 1, sizeof(uint64_t));
+}
+
+static inline void set_bit(uint64_t* set, size_t i)
+{
+    set[i / 64] |= 1ull << (i % 64);
+}
+
+static void add_word(struct dictionary* d, size_t idx, const char* word, size_t len)
+{
+    set_bit(d->byLen[len], idx);
+
+    for(size_t i = 0; i < len; i++) {
+        int c = word[i] - 'A';
+        if(c < 0 || c >= NUM_LETTERS)
+            continue;
+
+        set_bit(d->hasLetter[c], idx);
+        if(!d->atPos[c][i])
+            d->atPos[c][i] = new_bitset(d->blocks);
+        set_bit(d->atPos[c][i], idx);
+    }
+}
+
+// words is a ',' or '\n' separated list, it is uppercased in place
+static bool build_dictionary(struct dictionary* d, char* words)
+{
+    size_t count = 0;
+    size_t cap = 64;
+    char** list = malloc(cap * sizeof(*list));
+
+    memset(d, 0, sizeof(*d));
+    for(char* w = strtok(words, ",\r\n"); w && list; w = strtok(NULL, ",\r\n")) {
+        if(count == cap) {
+            cap *= 2;
+            char** grown = realloc(list, cap * sizeof(*list));
+            if(!grown) {
+                free(list);
+                return false;
+            }
+            list = grown;
+        }
+
+        list[count++] = w;
+    }
+
+    if(!list || count == 0) {
+        free(list);
+        return false;
+    }
+
+    d->wordCount = count;
+    d->blocks = (count + 63) / 64;
+    d->empty = new_bitset(d->blocks);
+    for(int l = 0; l <= MAX_LEN; l++)
+        d->byLen[l] = new_bitset(d->blocks);
+    for(int c = 0; c < NUM_LETTERS; c++)
+        d->hasLetter[c] = new_bitset(d->blocks);
+
+    for(size_t idx = 0; idx < count; idx++) {
+        char* w = list[idx];
+        size_t len = strlen(w);
+        for(size_t i = 0; i < len; i++) {
+            if(w[i] >= 'a' && w[i] <= 'z')
+                w[i] -= 'a' - 'A';
+        }
+
+        add_word(d, idx, w, len > MAX_LEN ? MAX_LEN : len);
+    }
+
+    free(list);
+    return true;
+}
+
+static void free_dictionary(struct dictionary* d)
+{
+    for(int l = 0; l <= MAX_LEN; l++)
+        free(d->byLen[l]);
+
+    for(int c = 0; c < NUM_LETTERS; c++) {
+        free(d->hasLetter[c]);
+        for(int i = 0; i < MAX_LEN; i++)
+            free(d->atPos[c][i]);
+    }
+
+    free(d->empty);
+}
+
+// candidates that have letter c exactly at the positions in revealed
+static void filter_letter(const struct dictionary* d, uint64_t* cand, int c,
+                          uint64_t revealed, int len)
+{
+    if(!revealed) {
+        const uint64_t* has = d->hasLetter[c];
+        for(size_t b = 0; b < d->blocks; b++)
+            cand[b] &= ~has[b];
+        return;
+    }
+
+    for(int i = 0; i < len; i++) {
+        const uint64_t* at = d->atPos[c][i] ? d->atPos[c][i] : d->empty;
+
+        if(revealed & (1ull << i)) {
+            for(size_t b = 0; b < d->blocks; b++)
+                cand[b] &= at[b];
+        } else {
+            for(size_t b = 0; b < d->blocks; b++)
+                cand[b] &= ~at[b];
+        }
+    }
+}
+
+// the unguessed letter contained in the most candidates
+static char pick_letter(const struct dictionary* d, const uint64_t* cand, uint32_t guessedMask)
+{
+    int best = -1;
+    uint64_t bestCount = 0;
+
+    for(int c = 0; c < NUM_LETTERS; c++) {
+        if(guessedMask & (1u << c))
+            continue;
+
+        const uint64_t* has = d->hasLetter[c];
+        uint64_t count = 0;
+        for(size_t b = 0; b < d->blocks; b++)
+            count += __builtin_popcountll(cand[b] & has[b]);
+
+        if(count > bestCount) {
+            best = c;
+            bestCount = count;
+        }
+    }
+
+    if(best >= 0)
+        return 'A' + best;
+
+    for(int i = 0; letterOrder[i]; i++) {
+        if(!(guessedMask & (1u << (letterOrder[i] - 'A'))))
+            return letterOrder[i];
+    }
+
+    return 0;
+}
+
+static uint64_t revealed_mask(const struct hangman_state* state, char letter)
+{
+    uint64_t mask = 0;
+    for(int i = 0; i < state->secret_len; i++) {
+        if(state->reveal[i] == letter)
+            mask |= 1ull << i;
+    }
+
+    return mask;
+}
+
+// play the game currently running on fd to the end
+static bool play_game(int fd, const struct dictionary* d, uint64_t* cand, struct solver_stats* stats)
+{
+    struct hangman_state state;
+    if(ioctl(fd, HANGMAN_IOC_GET_STATE, &state) != 0)
+        return false;
+
+    int len = state.secret_len;
+    memcpy(cand, d->byLen[len], d->blocks * sizeof(uint64_t));
+
+    while(state.status == HANGMAN_STATUS_PLAYING) {
+        char letter = pick_letter(d, cand, state.guessed_mask);
+        char guess[2] = { letter, '\0' };
+
+        if(!letter || write(fd, guess, 2) != 2)
+            return false;
+
+        if(ioctl(fd, HANGMAN_IOC_GET_STATE, &state) != 0)
+            return false;
+
+        uint64_t revealed = revealed_mask(&state, letter);
+        filter_letter(d, cand, letter - 'A', revealed, len);
+
+        stats->guesses++;
+        if(!revealed)
+            stats->misses++;
+    }
+
+    stats->games++;
+    if(state.status == HANGMAN_STATUS_WON)
+        stats->won++;
+
+    return true;
+}
+
+static void* worker_main(void* arg)
+{
+    struct worker* w = arg;
+    struct hangman_word_filter anyWord = {0};
+    uint64_t* cand = new_bitset(w->dict->blocks);
+
+    int fd = open(w->path, O_RDWR);
+    if(fd < 0 || !cand) {
+        w->stats.errors++;
+        goto out;
+    }
+
+    for(long i = 0; i < w->games; i++) {
+        // every fd starts with a game, later ones are started here
+        if(i != 0 && ioctl(fd, HANGMAN_IOC_SET_FILTER, &anyWord) != 0) {
+            w->stats.errors++;
+            break;
+        }
+
+        if(!play_game(fd, w->dict, cand, &w->stats)) {
+            w->stats.errors++;
+            break;
+        }
+    }
+
+out:
+    if(fd >= 0)
+        close(fd);
+
+    free(cand);
+    return NULL;
+}
+
+// stream a word list file into the driver and return its contents
+static char* load_word_file(const char* devPath, const char* path)
+{
+    FILE* f = fopen(path, "r");
+    if(!f) {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+
+    char* words = malloc(size + 1);
+    if(!words || fread(words, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "could not read %s\n", path);
+        fclose(f);
+        free(words);
+        return NULL;
+    }
+    words[size] = '\0';
+    fclose(f);
+
+    int fd = open(devPath, O_RDWR);
+    if(fd < 0) {
+        perror(devPath);
+        free(words);
+        return NULL;
+    }
+
+    bool ok = ioctl(fd, HANGMAN_IOC_BANK_BEGIN) == 0;
+    for(long off = 0; ok && off < size; off += CHUNK_SIZE) {
+        struct hangman_bank_chunk chunk = {
+            .data = (uintptr_t)(words + off),
+            .len = size - off < CHUNK_SIZE ? size - off : CHUNK_SIZE,
+        };
+        ok = ioctl(fd, HANGMAN_IOC_BANK_APPEND, &chunk) == 0;
+    }
+
+    if(ok)
+        ok = ioctl(fd, HANGMAN_IOC_BANK_COMMIT) == 0;
+    else
+        ioctl(fd, HANGMAN_IOC_BANK_ABORT);
+
+    close(fd);
+    if(!ok) {
+        perror("loading word bank");
+        free(words);
+        return NULL;
+    }
+
+    return words;
+}
+
+// copy the whole bank a page at a time, all pages from the same bank.
+// Returns false with errno set, ESTALE if the bank was replaced meanwhile
+static bool read_bank_pages(int fd, char** words)
+{
+    struct hangman_bank_read req = { 0 };
+    __u64 gen = 0;
+    __u32 offset = 0;
+    __u32 total = 0;
+
+    *words = NULL;
+    do {
+        if(!*words) {
+            req = (struct hangman_bank_read){ 0 };
+        } else {
+            req = (struct hangman_bank_read){
+                .data = (uintptr_t)(*words + offset),
+                .len = total - offset < CHUNK_SIZE ? total - offset : CHUNK_SIZE,
+                .offset = offset,
+                .gen = gen,
+            };
+        }
+
+        if(ioctl(fd, HANGMAN_IOC_BANK_READ, &req) != 0)
+            return false;
+
+        // the first call only learns the size and generation of the bank
+        if(!*words) {
+            *words = calloc(1, req.total + 1);
+            if(!*words)
+                return false;
+
+            gen = req.gen;
+            total = req.total;
+        } else if(req.len == 0) {
+            errno = EIO;
+            return false;
+        }
+
+        offset += req.len;
+    } while(offset < total);
+
+    return true;
+}
+
+// the bank as the driver shows it, listed again from the start if it is
+// replaced while being read
+static char* read_bank(const char* devPath)
+{
+    int fd = open(devPath, O_RDWR);
+    if(fd < 0) {
+        perror(devPath);
+        return NULL;
+    }
+
+    char* words = NULL;
+    bool ok;
+    do {
+        free(words);
+        ok = read_bank_pages(fd, &words);
+    } while(!ok && errno == ESTALE);
+
+    if(!ok) {
+        perror("HANGMAN_IOC_BANK_READ");
+        free(words);
+        words = NULL;
+    }
+
+    close(fd);
+    return words;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [-t threads] [-n games] [-f wordfile] [-p path]\n"
+            "  -t  number of threads, each with its own file descriptor (default 1)\n"
+            "  -n  games per thread (default 1000)\n"
+            "  -f  load this word list into the driver first and use it as the dictionary\n"
+            "  -p  device path (default " DEFAULT_PATH ")\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    const char* devPath = DEFAULT_PATH;
+    const char* wordFile = NULL;
+    int threads = 1;
+    long games = 1000;
+    int opt;
+
+    while((opt = getopt(argc, argv, "t:n:f:p:h")) != -1) {
+        switch(opt) {
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'n':
+            games = atol(optarg);
+            break;
+        case 'f':
+            wordFile = optarg;
+            break;
+        case 'p':
+            devPath = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(threads < 1 || games < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char* words = wordFile ? load_word_file(devPath, wordFile) : read_bank(devPath);
+    if(!words)
+        return 1;
+
+    struct dictionary dict;
+    if(!build_dictionary(&dict, words)) {
+        fprintf(stderr, "the word bank is empty\n");
+        return 1;
+    }
+
+    struct worker* workers = calloc(threads, sizeof(*workers));
+    if(!workers)
+        return 1;
+
+    double start = now_sec();
+    for(int i = 0; i < threads; i++) {
+        workers[i].dict = &dict;
+        workers[i].path = devPath;
+        workers[i].games = games;
+        if(pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+            perror("pthread_create");
+            threads = i;
+            break;
+        }
+    }
+
+    struct solver_stats total = {0};
+    for(int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        total.games += workers[i].stats.games;
+        total.won += workers[i].stats.won;
+        total.guesses += workers[i].stats.guesses;
+        total.misses += workers[i].stats.misses;
+        total.errors += workers[i].stats.errors;
+    }
+    double elapsed = now_sec() - start;
+
+    printf("dictionary words: %zu\n", dict.wordCount);
+    printf("threads: %d\n", threads);
+    printf("games: %llu (won %llu)\n", (unsigned long long)total.games, (unsigned long long)total.won);
+    printf("games/sec: %.1f\n", total.games / elapsed);
+    if(total.games) {
+        printf("average guesses: %.2f\n", (double)total.guesses / total.games);
+        printf("average misses: %.2f\n", (double)total.misses / total.games);
+        printf("win rate: %.1f%%\n", 100.0 * total.won / total.games);
+    }
+    if(total.errors)
+        printf("errors: %llu\n", (unsigned long long)total.errors);
+
+    free(workers);
+    free_dictionary(&dict);
+    free(words);
+    return total.errors ? 1 : 0;
+}
@@ -17,6 +17,7 @@ int main(void)
         test_ioctl_get_wordbank,
         test_ioctl_get_current_word,
         test_ioctl_set_current_word,
+        test_ioctl_set_unwinnable_word,
         test_ioctl_restart,
         test_write_correct_letter,
         test_write_wrong_letter,
@@ -25,6 +26,7 @@ int main(void)
         test_write_same_letter_twice,
         test_write_lower_case,
         test_write_too_many_letters,
+        test_write_unterminated_pairs,
         test_write_non_alphabetic,
         test_write_empty_string,
         test_reset_the_game,
@@ -37,6 +39,19 @@ int main(void)
         test_read_succeed_after_win,
         test_write_fail_after_win,
         test_game_reset_after_word_change,
+        test_sessions_are_independent,
+        test_write_batch,
+        test_ioctl_get_state,
+        test_mmap_state,
+        test_poll_state_change,
+        test_writev_guesses,
+        test_ioctl_game_handles,
+        test_ioctl_stream_wordbank,
+        test_ioctl_word_filter,
+        test_ioctl_secret_no_repeats,
+        test_ioctl_hint,
+        test_ioctl_bank_read,
+        test_ioctl_snapshot,
     };
 
     int numTests = sizeof(tests) / sizeof(tests[0]);
@@ -1,22 +1,28 @@
 #include "unitTest.h"
+#include "module/hangman_uapi.h"
 #include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <stdint.h>
 
 #define DRIVER_PATH "/dev/hangman"
-#define MAX_BANK_SIZE 500
-#define MAX_SECRET_SIZE 50
 
-// Ioctl command numbers
-#define HANGMAN_MAGIC_NUM   0xff
-#define HANGMAN_IOC_READ_BANK	 _IOR(HANGMAN_MAGIC_NUM, 1, char[MAX_BANK_SIZE])
-#define HANGMAN_IOC_READ_SECRET	 _IOR(HANGMAN_MAGIC_NUM, 2, char[MAX_SECRET_SIZE])
-#define HANGMAN_IOC_WRITE_BANK	 _IOW(HANGMAN_MAGIC_NUM, 3, char[MAX_BANK_SIZE])
-#define HANGMAN_IOC_WRITE_SECRET _IOW(HANGMAN_MAGIC_NUM, 4, char[MAX_SECRET_SIZE])
-#define HANGMAN_IOC_RESTART	 _IO(HANGMAN_MAGIC_NUM, 5)
+// lockless snapshot of the page mapped from the driver, see hangman_uapi.h
+static void read_shared_state(const volatile struct hangman_shared_state* page, struct hangman_state* state)
+{
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+        memcpy(state, (const void*)&page->state, sizeof(*state));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while((seq & 1) || seq != page->seq);
+}
 
 #define RETURN_ERROR(error, len, msg) { snprintf(error, len, "%s", msg == NULL ? strerror(errno) : msg); return false; }
 #define INIT_TEST(funcName, error, len) ({ snprintf(funcName, len, "%s", __FUNCTION__);\
@@ -221,6 +227,32 @@ bool test_ioctl_set_current_word(char* funcName, char* error, size_t len)
     RETURN_CLEANUP(fd, status, error, len, errMsg)
 }
 
+bool test_ioctl_set_unwinnable_word(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char secretBuf[MAX_SECRET_SIZE] = {0};
+    char oldSecret[MAX_SECRET_SIZE] = "TEST";
+    char newSecret[MAX_SECRET_SIZE] = "TEST_A";
+    char* errMsg = NULL;
+    char* emsgWr = "Accepted a secret word that is not all letters";
+    char* emsgCmp = "Rejected secret word replaced the old one";
+
+    if(ioctl(fd, HANGMAN_IOC_WRITE_SECRET, oldSecret) != 0) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_WRITE_SECRET, newSecret) == 0 || errno != EINVAL) {
+        status = false;
+        errMsg = emsgWr;
+    } else if(ioctl(fd, HANGMAN_IOC_READ_SECRET, secretBuf) != 0) {
+        status = false;
+    } else if(strncmp(secretBuf, "TEST", sizeof("TEST")) != 0) {
+        status = false;
+        errMsg = emsgCmp;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
 bool test_ioctl_restart(char* funcName, char* error, size_t len)
 {
     int fd = INIT_TEST(funcName, error, len);
@@ -410,6 +442,28 @@ bool test_write_too_many_letters(char* funcName, char* error, size_t len)
     RETURN_CLEANUP(fd, status, error, len, errMsg);
 }
 
+bool test_write_unterminated_pairs(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgWr = "Failed to block a write of letters without terminators";
+    char* emsgState = "Rejected write changed the game";
+    struct hangman_state state;
+
+    if(write(fd, "ABCD", 4) >= 0) {
+        status = false;
+        errMsg = emsgWr;
+    } else if(ioctl(fd, HANGMAN_IOC_GET_STATE, &state) != 0) {
+        status = false;
+    } else if(state.guessed_mask != 0 || state.num_guesses != 10) {
+        status = false;
+        errMsg = emsgState;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
 bool test_write_non_alphabetic(char* funcName, char* error, size_t len)
 {
     int fd = INIT_TEST(funcName, error, len);
@@ -582,13 +636,15 @@ bool test_ioctl_set_wordbank(char* funcName, char* error, size_t len)
     char* errMsg = NULL;
     char* emsgCmp = "Failed to properly update word bank";
     char newBank[MAX_BANK_SIZE] = "HELLO,GOODBYE,TEST_A,TEST_B";
+    // words that are not all letters could never be won, so they are skipped
+    char* expected = "HELLO,GOODBYE";
     char buf[MAX_BANK_SIZE] = {0};
 
     if(ioctl(fd, HANGMAN_IOC_WRITE_BANK, newBank) != 0) {
         status = false;
     } else if(ioctl(fd, HANGMAN_IOC_READ_BANK, buf) != 0) {
         status = false;
-    } else if(strncmp(buf, newBank, MAX_BANK_SIZE) != 0) {
+    } else if(strncmp(buf, expected, MAX_BANK_SIZE) != 0) {
         status = false;
         errMsg = emsgCmp;
     }
@@ -697,3 +753,529 @@ bool test_game_reset_after_word_change(char* funcName, char* error, size_t len)
 
     RETURN_CLEANUP(fd, status, error, len, errMsg);
 }
+
+bool test_sessions_are_independent(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* expected = "- - - - - - - \n\n10 guesses left\n";
+    char* errMsg = NULL;
+    char* emsgOpen = "Failed to open a second session";
+    char* emsgCmp = "Guess on one file descriptor changed another session's game";
+    char buf[128] = {0};
+
+    int fd2 = open(DRIVER_PATH, O_RDWR);
+    if(fd2 < 0)
+        RETURN_CLEANUP(fd, false, error, len, emsgOpen)
+
+    if(write(fd, "E", 2) != 2) {
+        status = false;
+    } else if(read(fd2, buf, 128) < 0) {
+        status = false;
+    } else if(strncmp(buf, expected, strlen(expected)) != 0) {
+        status = false;
+        errMsg = emsgCmp;
+    }
+
+    close(fd2);
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+bool test_write_batch(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* expected = "E X A - - - E \nZ\n9 guesses left\n";
+    uint8_t expectedResults[] = {HANGMAN_GUESS_HIT, HANGMAN_GUESS_HIT, HANGMAN_GUESS_HIT,
+                                 HANGMAN_GUESS_MISS, HANGMAN_GUESS_REPEAT};
+    char* errMsg = NULL;
+    char* emsgBatch = "Failed to enable batch mode";
+    char* emsgCmp = "Failed to properly update game board after batched guesses";
+    char* emsgRes = "Batch results do not match the guesses";
+    struct hangman_batch_result result = {0};
+    char buf[128] = {0};
+    int enable = 1;
+
+    if(ioctl(fd, HANGMAN_IOC_SET_BATCH, &enable) != 0) {
+        status = false;
+        errMsg = emsgBatch;
+    } else if(write(fd, "exazE", 5) != 5) {
+        status = false;
+    } else if(read(fd, buf, 128) < 0) {
+        status = false;
+    } else if(strncmp(buf, expected, strlen(expected)) != 0) {
+        status = false;
+        errMsg = emsgCmp;
+    } else if(ioctl(fd, HANGMAN_IOC_BATCH_RESULT, &result) != 0) {
+        status = false;
+    } else if(result.count != 5 || memcmp(result.results, expectedResults, 5) != 0) {
+        status = false;
+        errMsg = emsgRes;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+bool test_ioctl_get_state(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgRd = "Failed to read game state";
+    char* emsgCmp = "Returned game state does not match the board";
+    uint32_t guessed = (1u << ('E' - 'A')) | (1u << ('Z' - 'A'));
+    struct hangman_state state = {0};
+
+    if(write(fd, "E", 2) != 2) {
+        status = false;
+    } else if(write(fd, "Z", 2) != 2) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_GET_STATE, &state) != 0) {
+        status = false;
+        errMsg = emsgRd;
+    } else if(state.secret_len != 7 || state.num_guesses != 9 ||
+              state.status != HANGMAN_STATUS_PLAYING || state.guessed_mask != guessed ||
+              state.revealed_pos != 0x41 || state.bad_count != 1 || state.bad_guesses[0] != 'Z' ||
+              strcmp(state.reveal, "E-----E") != 0) {
+        status = false;
+        errMsg = emsgCmp;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+bool test_mmap_state(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgMap = "Failed to map the game state page";
+    char* emsgWr = "Driver allowed a writable mapping of the game state";
+    char* emsgCmp = "Mapped game state did not follow the game";
+    struct hangman_state before = {0}, after = {0};
+
+    void* bad = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(bad != MAP_FAILED) {
+        munmap(bad, 4096);
+        RETURN_CLEANUP(fd, false, error, len, emsgWr)
+    }
+
+    const struct hangman_shared_state* page = mmap(NULL, 4096, PROT_READ, MAP_SHARED, fd, 0);
+    if(page == MAP_FAILED)
+        RETURN_CLEANUP(fd, false, error, len, emsgMap)
+
+    read_shared_state(page, &before);
+    if(write(fd, "E", 2) != 2) {
+        status = false;
+    } else {
+        read_shared_state(page, &after);
+        if(strcmp(before.reveal, "-------") != 0 || strcmp(after.reveal, "E-----E") != 0 ||
+           after.gen == before.gen || after.num_guesses != 10) {
+            status = false;
+            errMsg = emsgCmp;
+        }
+    }
+
+    munmap((void*)page, 4096);
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+bool test_poll_state_change(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgNew = "New game was not reported as readable";
+    char* emsgRd = "Game was reported as readable after it was read";
+    char* emsgWr = "Guess did not make the game readable";
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    char buf[128] = {0};
+
+    if(poll(&pfd, 1, 0) != 1 || !(pfd.revents & POLLIN)) {
+        status = false;
+        errMsg = emsgNew;
+    } else if(read(fd, buf, 128) < 0) {
+        status = false;
+    } else if(poll(&pfd, 1, 0) != 0) {
+        status = false;
+        errMsg = emsgRd;
+    } else if(write(fd, "E", 2) != 2) {
+        status = false;
+    } else if(poll(&pfd, 1, 0) != 1 || !(pfd.revents & POLLIN)) {
+        status = false;
+        errMsg = emsgWr;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+bool test_writev_guesses(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* expected = "E X - - - - E \nZ\n9 guesses left\n";
+    char* errMsg = NULL;
+    char* emsgCmp = "Failed to properly update game board after vectored guesses";
+    struct iovec iov[] = { { "E", 2 }, { "X", 2 }, { "Z", 2 } };
+    char buf[128] = {0};
+
+    if(writev(fd, iov, 3) != 6) {
+        status = false;
+    } else if(read(fd, buf, 128) < 0) {
+        status = false;
+    } else if(strncmp(buf, expected, strlen(expected)) != 0) {
+        status = false;
+        errMsg = emsgCmp;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+// guess letters on a handle game until it is won or lost
+static bool play_out_handle_game(int fd, uint32_t handle)
+{
+    struct hangman_game_guess guess = { .handle = handle, .status = HANGMAN_STATUS_PLAYING };
+
+    for(char c = 'A'; c <= 'Z' && guess.status == HANGMAN_STATUS_PLAYING; c++) {
+        guess.letter = c;
+        if(ioctl(fd, HANGMAN_IOC_GAME_GUESS, &guess) != 0)
+            return false;
+    }
+
+    return guess.status != HANGMAN_STATUS_PLAYING;
+}
+
+bool test_ioctl_game_handles(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgCreate = "Failed to create games by handle";
+    char* emsgGuess = "Guess by handle returned the wrong result";
+    char* emsgState = "Games addressed by handle are not independent";
+    char* emsgDestroy = "Destroyed game handle is still usable";
+    char* emsgSkipped = "Guess on a finished game was not skipped";
+    uint32_t h0 = 0, h1 = 0;
+    struct hangman_game_guess guess = {0};
+    struct hangman_game_guess late = { .letter = 'A' };
+    struct hangman_game_state st0 = {0}, st1 = {0};
+
+    if(ioctl(fd, HANGMAN_IOC_GAME_CREATE, &h0) != 0 || ioctl(fd, HANGMAN_IOC_GAME_CREATE, &h1) != 0 ||
+       h0 == 0 || h1 == 0 || h0 == h1)
+        RETURN_CLEANUP(fd, false, error, len, emsgCreate)
+
+    guess.handle = h0;
+    guess.letter = 'z';
+    st0.handle = h0;
+    st1.handle = h1;
+    late.handle = h1;
+
+    if(ioctl(fd, HANGMAN_IOC_GAME_GUESS, &guess) != 0 || guess.result != HANGMAN_GUESS_MISS ||
+       guess.num_guesses != 9) {
+        status = false;
+        errMsg = emsgGuess;
+    } else if(ioctl(fd, HANGMAN_IOC_GAME_STATE, &st0) != 0 || ioctl(fd, HANGMAN_IOC_GAME_STATE, &st1) != 0 ||
+              st0.state.num_guesses != 9 || st1.state.num_guesses != 10) {
+        status = false;
+        errMsg = emsgState;
+    } else if(!play_out_handle_game(fd, h1)) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_GAME_GUESS, &late) != 0 || late.result != HANGMAN_GUESS_SKIPPED ||
+              late.status == HANGMAN_STATUS_PLAYING) {
+        status = false;
+        errMsg = emsgSkipped;
+    } else if(ioctl(fd, HANGMAN_IOC_GAME_DESTROY, &h0) != 0 ||
+              ioctl(fd, HANGMAN_IOC_GAME_GUESS, &guess) == 0 || errno != ENOENT) {
+        status = false;
+        errMsg = emsgDestroy;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+bool test_ioctl_stream_wordbank(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgLoad = "Failed to stream in a word bank";
+    char* emsgCmp = "Streamed word bank does not match the chunks sent";
+    char* chunks[] = {"hel", "LO\nGood", "bye,TEST_A\n", "TESTB"};
+    // words are uppercased on load, and skipped if they are not all letters
+    char* expected = "HELLO,GOODBYE,TESTB";
+    char buf[MAX_BANK_SIZE] = {0};
+
+    if(ioctl(fd, HANGMAN_IOC_BANK_BEGIN) != 0)
+        RETURN_CLEANUP(fd, false, error, len, emsgLoad)
+
+    for(int i = 0; i < 4; i++) {
+        struct hangman_bank_chunk chunk = { .data = (uintptr_t)chunks[i], .len = strlen(chunks[i]) };
+        if(ioctl(fd, HANGMAN_IOC_BANK_APPEND, &chunk) != 0)
+            RETURN_CLEANUP(fd, false, error, len, emsgLoad)
+    }
+
+    if(ioctl(fd, HANGMAN_IOC_BANK_COMMIT) != 0) {
+        status = false;
+        errMsg = emsgLoad;
+    } else if(ioctl(fd, HANGMAN_IOC_READ_BANK, buf) != 0) {
+        status = false;
+    } else if(strncmp(buf, expected, MAX_BANK_SIZE) != 0) {
+        status = false;
+        errMsg = emsgCmp;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+bool test_ioctl_word_filter(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgMatch = "Filter matching no word was accepted";
+    char* emsgCmp = "Secret does not match the filter";
+    char* emsgDifficulty = "Secret does not match the difficulty filter";
+    char newBank[MAX_BANK_SIZE] = "HELLO,GOODBYE,BANANA,TEST_A,TEST_B";
+    struct hangman_word_filter none = { .min_len = 20 };
+    struct hangman_word_filter seven = { .min_len = 7, .max_len = 7 };
+    // only BANANA has 3 distinct letters, HELLO has 4 and GOODBYE 6
+    struct hangman_word_filter three = { .min_difficulty = 3, .max_difficulty = 3 };
+    char secretBuf[MAX_SECRET_SIZE] = {0};
+
+    if(ioctl(fd, HANGMAN_IOC_WRITE_BANK, newBank) != 0) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_SET_FILTER, &none) == 0 || errno != ENOENT) {
+        status = false;
+        errMsg = emsgMatch;
+    } else if(ioctl(fd, HANGMAN_IOC_SET_FILTER, &seven) != 0) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_READ_SECRET, secretBuf) != 0) {
+        status = false;
+    } else if(strncmp(secretBuf, "GOODBYE", sizeof("GOODBYE")) != 0) {
+        status = false;
+        errMsg = emsgCmp;
+    } else if(ioctl(fd, HANGMAN_IOC_SET_FILTER, &three) != 0) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_READ_SECRET, secretBuf) != 0) {
+        status = false;
+    } else if(strncmp(secretBuf, "BANANA", sizeof("BANANA")) != 0) {
+        status = false;
+        errMsg = emsgDifficulty;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+#define BAG_WORDS 5
+
+static bool secrets_distinct(char secrets[][MAX_SECRET_SIZE], int count)
+{
+    for(int i = 0; i < count; i++) {
+        for(int j = i + 1; j < count; j++) {
+            if(strcmp(secrets[i], secrets[j]) == 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool test_ioctl_secret_no_repeats(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgRepeat = "A word was drawn again before every word was played";
+    char* emsgReshuffle = "A word was drawn twice in a row across a reshuffle";
+    char newBank[MAX_BANK_SIZE] = "APPLE,BERRY,CHERRY,GRAPE,MELON";
+    struct hangman_word_filter any = {0};
+    // two passes over the bank, so the second starts a new permutation
+    char secrets[BAG_WORDS * 2][MAX_SECRET_SIZE] = {{0}};
+
+    if(ioctl(fd, HANGMAN_IOC_WRITE_BANK, newBank) != 0)
+        RETURN_CLEANUP(fd, false, error, len, NULL)
+
+    for(int i = 0; i < BAG_WORDS * 2; i++) {
+        if(ioctl(fd, HANGMAN_IOC_SET_FILTER, &any) != 0 ||
+           ioctl(fd, HANGMAN_IOC_READ_SECRET, secrets[i]) != 0)
+            RETURN_CLEANUP(fd, false, error, len, NULL)
+    }
+
+    if(!secrets_distinct(secrets, BAG_WORDS) || !secrets_distinct(secrets + BAG_WORDS, BAG_WORDS)) {
+        status = false;
+        errMsg = emsgRepeat;
+    } else if(strcmp(secrets[BAG_WORDS - 1], secrets[BAG_WORDS]) == 0) {
+        status = false;
+        errMsg = emsgReshuffle;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+bool test_ioctl_hint(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgStart = "Wrong hint before any guess";
+    char* emsgGuess = "Wrong hint after a guess";
+    char newBank[MAX_BANK_SIZE] = "APPLE,AMPLE,MAPLE,ZEBRA";
+    char newSecret[MAX_SECRET_SIZE] = "AMPLE";
+    struct hangman_hint hint;
+
+    if(ioctl(fd, HANGMAN_IOC_WRITE_BANK, newBank) != 0) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_WRITE_SECRET, newSecret) != 0) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_HINT, &hint) != 0) {
+        status = false;
+    } else if(hint.candidates != 4 || hint.letter != 'A') {
+        status = false;
+        errMsg = emsgStart;
+    } else if(write(fd, "A", 2) != 2) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_HINT, &hint) != 0) {
+        status = false;
+    } else if(hint.candidates != 2 || hint.letter != 'E') {
+        // only APPLE and AMPLE start with A, E is in both
+        status = false;
+        errMsg = emsgGuess;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+// read the whole bank through HANGMAN_IOC_BANK_READ a few bytes at a time,
+// every page from the bank of the first one
+static bool read_bank_pages(int fd, char* buf, size_t size, __u64* gen)
+{
+    char page[4];
+    struct hangman_bank_read req = { 0 };
+    __u32 total = 0;
+
+    *gen = 0;
+    for(__u32 offset = 0; offset == 0 || offset < total; offset += req.len) {
+        req = (struct hangman_bank_read){ .data = (uintptr_t)page, .len = sizeof(page),
+                                          .offset = offset, .gen = *gen };
+        if(ioctl(fd, HANGMAN_IOC_BANK_READ, &req) != 0 || req.len == 0)
+            return false;
+
+        if(req.total >= size)
+            return false;
+
+        memcpy(buf + offset, page, req.len);
+        *gen = req.gen;
+        total = req.total;
+    }
+
+    buf[total] = '\0';
+    return true;
+}
+
+bool test_ioctl_bank_read(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgPages = "Paged bank does not match the bank written";
+    char* emsgCached = "Unchanged bank was copied again";
+    char* emsgStale = "Page of a replaced bank was not refused";
+    char newBank[MAX_BANK_SIZE] = "APPLE,AMPLE,MAPLE,ZEBRA";
+    char otherBank[MAX_BANK_SIZE] = "KERNEL,MODULE";
+    char pages[MAX_BANK_SIZE];
+    char page[4];
+    __u64 gen = 0;
+    struct hangman_bank_read cached = { .data = (uintptr_t)page, .len = sizeof(page),
+                                        .flags = HANGMAN_BANK_READ_IF_CHANGED };
+    struct hangman_bank_read stale = { .data = (uintptr_t)page, .len = sizeof(page),
+                                       .offset = 4 };
+
+    if(ioctl(fd, HANGMAN_IOC_WRITE_BANK, newBank) != 0) {
+        status = false;
+    } else if(!read_bank_pages(fd, pages, sizeof(pages), &gen)) {
+        status = false;
+    } else if(strcmp(pages, newBank) != 0) {
+        status = false;
+        errMsg = emsgPages;
+    }
+
+    cached.gen = gen;
+    stale.gen = gen;
+
+    if(!status) {
+        // the listing itself failed
+    } else if(ioctl(fd, HANGMAN_IOC_BANK_READ, &cached) != 0) {
+        status = false;
+    } else if(cached.len != 0 || cached.gen != gen) {
+        status = false;
+        errMsg = emsgCached;
+    } else if(ioctl(fd, HANGMAN_IOC_WRITE_BANK, otherBank) != 0) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_BANK_READ, &stale) == 0 || errno != ESTALE) {
+        // the second page of a listing started before the bank changed
+        status = false;
+        errMsg = emsgStale;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
+
+bool test_ioctl_snapshot(char* funcName, char* error, size_t len)
+{
+    int fd = INIT_TEST(funcName, error, len);
+    bool status = true;
+    char* errMsg = NULL;
+    char* emsgSize = "Snapshot size was not reported for an empty buffer";
+    char* emsgSave = "Failed to save a snapshot";
+    char* emsgLoad = "Failed to load a snapshot";
+    char* emsgBank = "Word bank was not restored";
+    char* emsgGame = "Game was not restored";
+    char* emsgHandle = "Game by handle was not restored";
+    char newBank[MAX_BANK_SIZE] = "APPLE,AMPLE,MAPLE,ZEBRA";
+    char newSecret[MAX_SECRET_SIZE] = "AMPLE";
+    char bank[MAX_BANK_SIZE] = { 0 };
+    char secret[MAX_SECRET_SIZE] = { 0 };
+    char snapshot[4096];
+    struct hangman_snapshot_buf sizeReq = { 0 };
+    struct hangman_snapshot_buf req = { .data = (uintptr_t)snapshot, .len = sizeof(snapshot) };
+    struct hangman_state state;
+    struct hangman_game_state handleState = { 0 };
+    uint32_t handle = 0;
+
+    if(ioctl(fd, HANGMAN_IOC_WRITE_BANK, newBank) != 0 || ioctl(fd, HANGMAN_IOC_WRITE_SECRET, newSecret) != 0 ||
+       write(fd, "Z", 2) != 2 || ioctl(fd, HANGMAN_IOC_GAME_CREATE, &handle) != 0)
+        RETURN_CLEANUP(fd, false, error, len, NULL)
+
+    handleState.handle = handle;
+
+    if(ioctl(fd, HANGMAN_IOC_SNAPSHOT_SAVE, &sizeReq) == 0 || errno != ENOSPC || sizeReq.len == 0) {
+        status = false;
+        errMsg = emsgSize;
+    } else if(ioctl(fd, HANGMAN_IOC_SNAPSHOT_SAVE, &req) != 0 || req.len != sizeReq.len) {
+        status = false;
+        errMsg = emsgSave;
+    } else if(ioctl(fd, HANGMAN_IOC_RESTART) != 0 || ioctl(fd, HANGMAN_IOC_GAME_DESTROY, &handle) != 0) {
+        status = false;
+    } else if(ioctl(fd, HANGMAN_IOC_SNAPSHOT_LOAD, &req) != 0) {
+        status = false;
+        errMsg = emsgLoad;
+    } else if(ioctl(fd, HANGMAN_IOC_READ_BANK, bank) != 0 || strcmp(bank, newBank) != 0) {
+        status = false;
+        errMsg = emsgBank;
+    } else if(ioctl(fd, HANGMAN_IOC_READ_SECRET, secret) != 0 || strcmp(secret, newSecret) != 0 ||
+              ioctl(fd, HANGMAN_IOC_GET_STATE, &state) != 0 || state.num_guesses != 9 ||
+              state.bad_count != 1 || state.bad_guesses[0] != 'Z') {
+        status = false;
+        errMsg = emsgGame;
+    } else if(ioctl(fd, HANGMAN_IOC_GAME_STATE, &handleState) != 0 ||
+              handleState.state.num_guesses != 10) {
+        status = false;
+        errMsg = emsgHandle;
+    } else if(ioctl(fd, HANGMAN_IOC_SNAPSHOT_LOAD, &req) == 0 || errno != EBUSY) {
+        // the handle is taken by the game just restored
+        status = false;
+        errMsg = emsgLoad;
+    }
+
+    RETURN_CLEANUP(fd, status, error, len, errMsg);
+}
@@ -14,6 +14,7 @@ bool test_read_third_line(char*funcName, char* error, size_t len);
 bool test_ioctl_get_wordbank(char*funcName, char* error, size_t len);
 bool test_ioctl_get_current_word(char*funcName, char* error, size_t len);
 bool test_ioctl_set_current_word(char*funcName, char* error, size_t len);
+bool test_ioctl_set_unwinnable_word(char*funcName, char* error, size_t len);
 bool test_ioctl_restart(char*funcName, char* error, size_t len);
 bool test_write_correct_letter(char*funcName, char* error, size_t len);
 bool test_write_correct_letter(char*funcName, char* error, size_t len);
@@ -23,6 +24,7 @@ bool test_write_two_wrong(char*funcName, char* error, size_t len);
 bool test_write_same_letter_twice(char*funcName, char* error, size_t len);
 bool test_write_lower_case(char*funcName, char* error, size_t len);
 bool test_write_too_many_letters(char*funcName, char* error, size_t len);
+bool test_write_unterminated_pairs(char*funcName, char* error, size_t len);
 bool test_write_non_alphabetic(char*funcName, char* error, size_t len);
 bool test_write_empty_string(char*funcName, char* error, size_t len);
 bool test_reset_the_game(char*funcName, char* error, size_t len);
@@ -35,5 +37,18 @@ bool test_llseek_cur(char*funcName, char* error, size_t len);
 bool test_read_succeed_after_win(char*funcName, char* error, size_t len);
 bool test_write_fail_after_win(char*funcName, char* error, size_t len);
 bool test_game_reset_after_word_change(char*funcName, char* error, size_t len);
+bool test_sessions_are_independent(char*funcName, char* error, size_t len);
+bool test_write_batch(char*funcName, char* error, size_t len);
+bool test_ioctl_get_state(char*funcName, char* error, size_t len);
+bool test_mmap_state(char*funcName, char* error, size_t len);
+bool test_poll_state_change(char*funcName, char* error, size_t len);
+bool test_writev_guesses(char*funcName, char* error, size_t len);
+bool test_ioctl_game_handles(char*funcName, char* error, size_t len);
+bool test_ioctl_stream_wordbank(char*funcName, char* error, size_t len);
+bool test_ioctl_word_filter(char*funcName, char* error, size_t len);
+bool test_ioctl_secret_no_repeats(char*funcName, char* error, size_t len);
+bool test_ioctl_hint(char*funcName, char* error, size_t len);
+bool test_ioctl_bank_read(char*funcName, char* error, size_t len);
+bool test_ioctl_snapshot(char*funcName, char* error, size_t len);
 
 #endif